@@ -0,0 +1,231 @@
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <random>
+#include <string>
+#include <thread>
+
+#include "check_brackets.hpp"
+
+/**
+ * @brief Generate a balanced text with brackets, words and whitespace.
+ * @param filename is the output file.
+ * @param size is the approximated size in bytes.
+ */
+void
+generate_input(std::string const& filename, size_t size)
+{
+    std::ofstream out (filename, std::ios::binary);
+    std::mt19937 gen (1);
+    std::string opened;
+    std::string line;
+    size_t written = 0;
+    while (written < size)
+    {
+        line.clear();
+        while (line.size() < 72)
+        {
+            const unsigned r = gen() % 16;
+            if (r < 2 && opened.size() < 64)
+            {
+                const char o = "([{"[gen() % 3];
+                opened.push_back(o);
+                line.push_back(o);
+            }
+            else if (r < 4 && !opened.empty())
+            {
+                const char o = opened.back();
+                opened.pop_back();
+                line.push_back(o == '(' ? ')' : (o == '[' ? ']' : '}'));
+            }
+            else if (r < 7)
+            {
+                line.push_back(' ');
+            }
+            else
+            {
+                line.push_back(char('a' + gen() % 26));
+            }
+        }
+        line.push_back('\n');
+        out << line;
+        written += line.size();
+    }
+    while (!opened.empty())
+    {
+        const char o = opened.back();
+        opened.pop_back();
+        out << (o == '(' ? ')' : (o == '[' ? ']' : '}'));
+    }
+    out << '\n';
+}
+
+/**
+ * @brief The check_brackets(std::istream&) loop over a memory buffer.
+ * It classifies each character with a chain of comparisons.
+ */
+size_t
+check_brackets_branchy(const char* data, size_t size)
+{
+    size_t pos = 0;
+    bool unbalanced_found = false;
+    Stack< Bracket, ArrayStackStorage<Bracket> > stack;
+    for (size_t i = 0; i < size && !unbalanced_found; ++i)
+    {
+        const char next_c = data[i];
+        if (next_c == ' ' || (next_c >= '\t' && next_c <= '\r'))
+            continue;
+        ++pos;
+        if (next_c == '(' || next_c == '{' || next_c == '[')
+        {
+            stack.push(Bracket(next_c, pos));
+        }
+        else if (next_c == ')' || next_c == '}' || next_c == ']')
+        {
+            if(stack.is_empty() || !stack.top().match_with(next_c))
+                unbalanced_found = true;
+            else
+                stack.pop();
+        }
+    }
+    size_t ret_val = 0;
+    if (unbalanced_found)
+        ret_val = pos;
+    else if (!stack.is_empty())
+        ret_val = stack.top().pos();
+    return ret_val;
+}
+
+/**
+ * @brief Run a check and print its throughput.
+ * @param name is the label printed.
+ * @param bytes is the input size.
+ * @param check returns the check_brackets result.
+ * @return the check_brackets result.
+ */
+template <class Check>
+size_t
+run(std::string const& name, size_t bytes, Check check)
+{
+    auto start = std::chrono::steady_clock::now();
+    size_t pos = check();
+    auto stop = std::chrono::steady_clock::now();
+    double secs = std::chrono::duration<double>(stop - start).count();
+    std::cout << name << "\t" << (bytes / (1024.0 * 1024.0)) / secs
+              << " MB/s\t(result " << pos << ")" << std::endl;
+    return pos;
+}
+
+int
+main(int argc, const char* argv[])
+{
+    if (argc > 3)
+    {
+        std::cerr << "Usage: bench_check_brackets [filename | size_in_MB]"
+                  << " [max_threads]" << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    std::string filename = "bench_check_brackets.tmp";
+    bool generated = true;
+    size_t mb = 64;
+    unsigned max_threads = std::max(1u, std::thread::hardware_concurrency());
+    if (argc == 3)
+        max_threads = unsigned(std::strtoul(argv[2], nullptr, 10));
+    if (argc >= 2)
+    {
+        char* end = nullptr;
+        mb = std::strtoul(argv[1], &end, 10);
+        if (*end != '\0' || mb == 0)
+        {
+            filename = argv[1];
+            generated = false;
+        }
+    }
+    if (generated)
+        generate_input(filename, mb << 20);
+
+    std::ifstream input (filename, std::ios::binary | std::ios::ate);
+    if (!input)
+    {
+        std::cerr << "Error: could not open input filename '" << filename
+                  << "'." << std::endl;
+        return EXIT_FAILURE;
+    }
+    const size_t bytes = size_t(input.tellg());
+    input.close();
+    std::cout << "Input: " << filename << " (" << bytes << " bytes)"
+              << std::endl;
+
+    size_t expected = run("istream ", bytes, [&]()
+    {
+        std::ifstream in (filename);
+        return check_brackets(in);
+    });
+    size_t buffered = run("buffered", bytes, [&]()
+    {
+        std::ifstream in (filename, std::ios::binary);
+        return check_brackets_buffered(in);
+    });
+    size_t mapped = run("file    ", bytes, [&]()
+    {
+        return check_brackets_file(filename);
+    });
+
+    bool same = buffered == expected && mapped == expected;
+
+    std::string data;
+    {
+        std::ifstream in (filename, std::ios::binary);
+        data.assign(std::istreambuf_iterator<char>(in),
+                    std::istreambuf_iterator<char>());
+    }
+    //Delimiter classification: comparisons, compile time and run time tables.
+    const DelimiterSet runtime_delimiters ("()[]{}");
+    const DelimiterSet angle_delimiters ("()[]{}<>");
+    same = same && run("branchy ", bytes, [&]()
+    {
+        return check_brackets_branchy(data.data(), data.size());
+    }) == expected;
+    same = same && run("static  ", bytes, [&]()
+    {
+        return check_brackets(data.data(), data.size());
+    }) == expected;
+    same = same && run("runtime ", bytes, [&]()
+    {
+        return check_brackets(data.data(), data.size(), runtime_delimiters);
+    }) == expected;
+    run("runtime <>", bytes, [&]()
+    {
+        return check_brackets(data.data(), data.size(), angle_delimiters);
+    });
+    //The generated input has no literals or comments, so the result is the same.
+    const SourceDelimiters<DelimiterSet> source_delimiters (runtime_delimiters);
+    same = same && run("source  ", bytes, [&]()
+    {
+        return check_brackets(data.data(), data.size(), source_delimiters);
+    }) == expected;
+    //Scaling of the parallel checker over an input already in memory.
+    for (unsigned t = 1; t <= max_threads; ++t)
+    {
+        size_t parallel = run("threads " + std::to_string(t), bytes, [&]()
+        {
+            return check_brackets_parallel(data.data(), data.size(), t);
+        });
+        same = same && parallel == expected;
+    }
+
+    if (generated)
+        std::remove(filename.c_str());
+
+    if (!same)
+    {
+        std::cerr << "Error: results differ." << std::endl;
+        return EXIT_FAILURE;
+    }
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,235 @@
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "slist.hpp"
+#include "pooled_slist.hpp"
+#include "stack.hpp"
+
+/**
+ * @brief Time a task in nanoseconds per operation.
+ * @param ops is the number of operations done by the task.
+ */
+template <class Task>
+double
+ns_per_op(size_t ops, Task task)
+{
+    auto start = std::chrono::steady_clock::now();
+    task();
+    auto stop = std::chrono::steady_clock::now();
+    return std::chrono::duration<double, std::nano>(stop - start).count() / ops;
+}
+
+/**
+ * @brief Run push/find/pop rounds over a list type.
+ * @param name is the label printed.
+ * @param n is the number of items.
+ * @param rounds is the number of push/find/pop rounds.
+ */
+template <class List>
+void
+run(std::string const& name, size_t n, size_t rounds)
+{
+    double push_ns = 0.0;
+    double find_ns = 0.0;
+    double pop_ns = 0.0;
+    size_t found = 0;
+    List l;
+
+    for (size_t r = 0; r < rounds; ++r)
+    {
+        push_ns += ns_per_op(n, [&]()
+        {
+            for (size_t i = 0; i < n; ++i)
+                l.push_front(int(i));
+        });
+        find_ns += ns_per_op(n, [&]()
+        {
+            //Half of the values are missing so the cursor walks the whole list.
+            for (size_t i = 0; i < 16; ++i)
+                found += l.find(int(i * n / 8)) ? 1 : 0;
+        }) / 16.0;
+        pop_ns += ns_per_op(n, [&]()
+        {
+            while (!l.is_empty())
+                l.pop_front();
+        });
+    }
+
+    std::cout << name
+              << "\tpush_front " << push_ns / rounds << " ns/op"
+              << "\tfind " << find_ns / rounds << " ns/node"
+              << "\tpop_front " << pop_ns / rounds << " ns/op"
+              << "\t(found " << found << ")" << std::endl;
+}
+
+/**
+ * @brief Compare copying, moving and building in place std::string items.
+ * The strings are longer than the small string buffer, so each copy
+ * allocates.
+ * @param name is the label printed.
+ * @param n is the number of items.
+ * @param rounds is the number of rounds.
+ */
+template <class List>
+void
+run_strings(std::string const& name, size_t n, size_t rounds)
+{
+    const std::string pattern (40, 'x');
+    std::vector<std::string> items (n, pattern);
+    double copy_ns = 0.0;
+    double move_ns = 0.0;
+    double emplace_ns = 0.0;
+    List l;
+
+    for (size_t r = 0; r < rounds; ++r)
+    {
+        copy_ns += ns_per_op(n, [&]()
+        {
+            for (size_t i = 0; i < n; ++i)
+                l.push_front(items[i]);
+        });
+        while (!l.is_empty())
+            l.pop_front();
+        move_ns += ns_per_op(n, [&]()
+        {
+            for (size_t i = 0; i < n; ++i)
+                l.push_front(std::move(items[i]));
+        });
+        while (!l.is_empty())
+            l.pop_front();
+        emplace_ns += ns_per_op(n, [&]()
+        {
+            for (size_t i = 0; i < n; ++i)
+                l.emplace_front(size_t(40), 'x');
+        });
+        while (!l.is_empty())
+            l.pop_front();
+        items.assign(n, pattern);
+    }
+
+    std::cout << name
+              << "\tcopy " << copy_ns / rounds << " ns/op"
+              << "\tmove " << move_ns / rounds << " ns/op"
+              << "\templace " << emplace_ns / rounds << " ns/op" << std::endl;
+}
+
+/**
+ * @brief Time unfolding a list of std::string items from a stream.
+ * @param n is the number of items.
+ * @param rounds is the number of rounds.
+ */
+void
+run_create(size_t n, size_t rounds)
+{
+    std::ostringstream text;
+    text << "[";
+    for (size_t i = 0; i < n; ++i)
+        text << " " << std::string(40, char('a' + i % 26));
+    text << " ]";
+    const std::string input = text.str();
+
+    double list_ns = 0.0;
+    double stack_ns = 0.0;
+    for (size_t r = 0; r < rounds; ++r)
+    {
+        list_ns += ns_per_op(n, [&]()
+        {
+            std::istringstream in (input);
+            SList<std::string>::create(in);
+        });
+        stack_ns += ns_per_op(n, [&]()
+        {
+            std::istringstream in (input);
+            Stack< std::string, ArrayStackStorage<std::string> >::create(in);
+        });
+    }
+    std::cout << "create(istream) SList " << list_ns / rounds << " ns/item"
+              << "\tStack " << stack_ns / rounds << " ns/item" << std::endl;
+}
+
+/**
+ * @brief Time appending, unfolding from a stream and removing at the cursor.
+ * The cursor walks the list removing every second item, so the last
+ * remove() is at the tail.
+ * @param name is the label printed.
+ * @param n is the number of items.
+ * @param rounds is the number of rounds.
+ */
+template <class List>
+void
+run_tail(std::string const& name, size_t n, size_t rounds)
+{
+    std::ostringstream text;
+    text << "[";
+    for (size_t i = 0; i < n; ++i)
+        text << " " << i;
+    text << " ]";
+    const std::string input = text.str();
+
+    double push_ns = 0.0;
+    double create_ns = 0.0;
+    double remove_ns = 0.0;
+    size_t size = 0;
+    for (size_t r = 0; r < rounds; ++r)
+    {
+        List l;
+        push_ns += ns_per_op(n, [&]()
+        {
+            for (size_t i = 0; i < n; ++i)
+                l.push_back(int(i));
+        });
+        typename List::Ref unfolded;
+        create_ns += ns_per_op(n, [&]()
+        {
+            std::istringstream in (input);
+            unfolded = List::create(in);
+        });
+        remove_ns += ns_per_op(n / 2, [&]()
+        {
+            unfolded->goto_first();
+            while (unfolded->has_next())
+            {
+                unfolded->goto_next();
+                unfolded->remove();
+            }
+        });
+        size += unfolded->size();
+    }
+
+    std::cout << name
+              << "\tpush_back " << push_ns / rounds << " ns/op"
+              << "\tcreate(istream) " << create_ns / rounds << " ns/item"
+              << "\tremove " << remove_ns / rounds << " ns/op"
+              << "\t(size " << size / rounds << ")" << std::endl;
+}
+
+int
+main(int argc, const char* argv[])
+{
+    size_t n = 1000000;
+    size_t rounds = 5;
+    if (argc > 1)
+        n = std::strtoul(argv[1], nullptr, 10);
+    if (argc > 2)
+        rounds = std::strtoul(argv[2], nullptr, 10);
+    if (argc > 3 || n == 0 || rounds == 0)
+    {
+        std::cerr << "Usage: bench_slist [n_items] [rounds]" << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    std::cout << "Items: " << n << " rounds: " << rounds << std::endl;
+    run< SList<int> >("SList      ", n, rounds);
+    run< PooledSList<int> >("PooledSList", n, rounds);
+    run_tail< SList<int> >("SList      ", n, rounds);
+    run_tail< PooledSList<int> >("PooledSList", n, rounds);
+    std::cout << "std::string items:" << std::endl;
+    run_strings< SList<std::string> >("SList      ", n, rounds);
+    run_strings< PooledSList<std::string> >("PooledSList", n, rounds);
+    run_create(n, rounds);
+    return EXIT_SUCCESS;
+}
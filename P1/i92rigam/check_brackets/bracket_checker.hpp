@@ -0,0 +1,540 @@
+#ifndef __ED_BracketChecker_HPP__
+#define __ED_BracketChecker_HPP__
+
+#include <cstdio>
+#include <functional>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+#include "delimiters.hpp"
+#include "stack.hpp"
+
+/** @brief A bracket found at a given position.*/
+class Bracket
+{
+public:
+    Bracket()
+        : _c(0), _pos(0)
+    {
+    }
+    Bracket(char c, size_t pos )
+        : _c(c), _pos(pos)
+    {
+    }
+
+    bool match_with(char o) const
+    {
+        return ( (_c == '{' && o == '}') ||
+                 (_c == '[' && o == ']') ||
+                 (_c == '(' && o == ')'));
+    }
+    char c() const
+    {
+        return _c;
+    }
+    size_t pos() const
+    {
+        return _pos;
+    }
+    bool operator==(Bracket const& other) const
+    {
+        return _c==other._c && _pos==other._pos;
+    }
+protected:
+    char _c;
+    size_t _pos;
+};
+
+/** @brief An unbalanced bracket found by the error collection mode.*/
+struct BracketError
+{
+    /** @brief Position of the bracket, counted as check_brackets does.*/
+    size_t pos;
+    /** @brief The closing bracket found, or 0 if an opening bracket was
+     *  not closed before the end of the input.*/
+    char found;
+    /** @brief The closing bracket expected, or 0 if no bracket was open.*/
+    char expected;
+    /** @brief Number of brackets open before this one was found.*/
+    size_t depth;
+};
+
+/** @brief Receives the errors as they are found.*/
+typedef std::function<void (BracketError const&)> BracketErrorSink;
+
+/**
+ * @brief Block oriented bracket checker.
+ *
+ * The input is given as a sequence of memory blocks. Positions are counted
+ * as check_brackets(std::istream&) does: the index (from 1) of the character
+ * skipping the whitespace characters of the "C" locale.
+ *
+ * The Delimiters policy gives the bracket pairs: a StaticDelimiterSet fixed
+ * at compile time or a DelimiterSet given at run time. With a
+ * SourceDelimiters policy a small lexer state machine runs over the same scan
+ * and the brackets into string or char literals and comments are skipped.
+ * The characters into those regions are counted as any other one.
+ *
+ * By default the checker stops at the first unbalanced bracket. When an
+ * error sink is given, it recovers and goes on: every error is sent to the
+ * sink when found, so the memory used is proportional to the maximum
+ * nesting depth and not to the input size.
+ */
+template <class Delimiters = DefaultDelimiters>
+class BasicBracketChecker
+{
+public:
+
+    /** @brief Size of the blocks read by check_file.*/
+    static const size_t BLOCK_SIZE = 1 << 20;
+
+    /**
+     * @brief Create a checker ready to process a new input.
+     * @param delimiters are the bracket pairs to check.
+     */
+    BasicBracketChecker(Delimiters const& delimiters = Delimiters())
+        : delimiters_(delimiters), pos_(0), unbalanced_found_(false),
+          lexer_(CODE), offset_(0), mark_(0), depth_(0), n_errors_(0),
+          first_error_(0)
+    {
+    }
+
+    /** @brief Get the bracket pairs checked.*/
+    Delimiters const& delimiters() const
+    {
+        return delimiters_;
+    }
+
+    /**
+     * @brief Reset the checker to process a new input.
+     * The memory of the stack is kept to be reused.
+     */
+    void reset()
+    {
+        while (!stack_.is_empty())
+            stack_.pop();
+        pos_ = 0;
+        unbalanced_found_ = false;
+        lexer_ = CODE;
+        offset_ = 0;
+        mark_ = 0;
+        depth_ = 0;
+        n_errors_ = 0;
+        first_error_ = 0;
+    }
+
+    /**
+     * @brief Set the error collection mode.
+     *
+     * A closing bracket that does not match the open one is reported and
+     * closes it, a closing bracket without any open one is reported and
+     * skipped. Call finish() at the end of the input to report the brackets
+     * left open, from the innermost one.
+     *
+     * @param sink receives the errors, an empty sink restores the default
+     *        mode that stops at the first error.
+     */
+    void collect_errors(BracketErrorSink sink)
+    {
+        sink_ = sink;
+    }
+
+    /**
+     * @brief Report the brackets left open to the error sink.
+     * @pre the error collection mode is set.
+     */
+    void finish()
+    {
+        while (!stack_.is_empty())
+        {
+            --depth_;
+            report(stack_.top().pos(), 0, delimiters_.closing(stack_.top().c()));
+            stack_.pop();
+        }
+    }
+
+    /** @brief Number of errors reported to the sink.*/
+    size_t n_errors() const
+    {
+        return n_errors_;
+    }
+
+    /**
+     * @brief Process the next block of the input.
+     * @param data is the block.
+     * @param size is the block's size in bytes.
+     * @return false if an unbalanced bracket was found, so the remaining
+     *         input does not need to be processed.
+     */
+    bool feed(const char* data, size_t size)
+    {
+        if (!unbalanced_found_)
+        {
+            scan(data, data + size, pos_, [this, data](const char* at)
+            {
+                return process_char(*at, offset_ + size_t(at - data));
+            });
+            offset_ += size;
+        }
+        return !unbalanced_found_;
+    }
+
+    /** @brief Was a closing bracket without match found?*/
+    bool unbalanced_found() const
+    {
+        return unbalanced_found_;
+    }
+
+    /**
+     * @brief Get the result for the input processed up to now.
+     * @return 0 if all the brackets are well balanced, or the input character
+     *         index for the bracket that is not balanced otherwise.
+     */
+    size_t result() const
+    {
+        size_t ret_val = 0;
+
+        if(unbalanced_found_)
+        {
+            ret_val = pos_;
+        }
+
+        else if(n_errors_ > 0)
+        {
+            ret_val = first_error_;
+        }
+
+        else if(!stack_.is_empty())
+        {
+            ret_val = stack_.top().pos();
+        }
+
+        return ret_val;
+    }
+
+    /**
+     * @brief Check a whole file.
+     * The checker is reset before and its read buffer is reused, so checking
+     * many files with the same checker does not allocate memory per file.
+     * In error collection mode finish() is called at the end.
+     * @param filename is the file's name.
+     * @param[out] bytes is the number of bytes read.
+     * @return the check_brackets result for the file.
+     * @warning throw std::runtime_error if the file could not be read.
+     */
+    size_t check_file(std::string const& filename, size_t& bytes) noexcept(false)
+    {
+        reset();
+        bytes = 0;
+        std::FILE* file = std::fopen(filename.c_str(), "rb");
+        if (file == nullptr)
+        {
+            throw std::runtime_error("could not open input filename '"
+                                     + filename + "'.");
+        }
+        std::setvbuf(file, nullptr, _IONBF, 0);
+        if (buffer_.empty())
+            buffer_.resize(BLOCK_SIZE);
+        size_t n = 0;
+        do
+        {
+            n = std::fread(buffer_.data(), 1, buffer_.size(), file);
+            bytes += n;
+        }
+        while (n > 0 && feed(buffer_.data(), n));
+        const bool read_error = std::ferror(file) != 0;
+        std::fclose(file);
+        if (read_error)
+        {
+            throw std::runtime_error("could not read input filename '"
+                                     + filename + "'.");
+        }
+        if (sink_)
+            finish();
+        return result();
+    }
+
+    /**
+     * @brief Scan a block of input looking for brackets.
+     *
+     * The position counts the non whitespace characters. Process is called
+     * with a pointer to each byte whose class is not OTHER_CHAR or SPACE_CHAR,
+     * with pos being the byte's position, and it returns false to stop the
+     * scanning.
+     *
+     * @param p,
+     * @param end specify the [p, end) block.
+     * @param pos is the position of the last character already scanned.
+     * @param process is the handler.
+     * @return false if process stopped the scanning.
+     */
+    template <class Process>
+    bool scan(const char* p, const char* end, size_t& pos, Process process) const
+    {
+        bool go_on = true;
+
+#ifdef __SSE2__
+        //Classify 16 bytes at once. Blocks without brackets only update the
+        //position, the brackets of the others are processed one by one.
+        if (delimiters_.size() <= MAX_SIMD_DELIMITERS)
+        {
+            const size_t n_delimiters = delimiters_.size();
+            __m128i delimiter[MAX_SIMD_DELIMITERS];
+            for (size_t k = 0; k < n_delimiters; ++k)
+                delimiter[k] = _mm_set1_epi8(delimiters_.chars()[k]);
+            const __m128i space = _mm_set1_epi8(' ');
+            const __m128i tab = _mm_set1_epi8('\t');
+            const __m128i ctrl_space_range = _mm_set1_epi8('\r' - '\t');
+            const __m128i signed_bias = _mm_set1_epi8(char(0x80));
+            while (go_on && end - p >= 16)
+            {
+                const __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+                //'\t'..'\r' is a range: (c - '\t') <= 4 as unsigned bytes.
+                const __m128i ctrl = _mm_cmpgt_epi8(
+                            _mm_xor_si128(ctrl_space_range, signed_bias),
+                            _mm_xor_si128(_mm_sub_epi8(v, tab), signed_bias));
+                const __m128i ctrl_eq = _mm_cmpeq_epi8(_mm_sub_epi8(v, tab),
+                                                       ctrl_space_range);
+                const unsigned ws = unsigned(_mm_movemask_epi8(
+                            _mm_or_si128(_mm_or_si128(ctrl, ctrl_eq),
+                                         _mm_cmpeq_epi8(v, space))));
+                __m128i br = _mm_setzero_si128();
+                for (size_t k = 0; k < n_delimiters; ++k)
+                    br = _mm_or_si128(br, _mm_cmpeq_epi8(v, delimiter[k]));
+                unsigned brackets = unsigned(_mm_movemask_epi8(br));
+                const unsigned non_ws = ~ws & 0xFFFFu;
+                unsigned done = 0;
+                while (brackets != 0 && go_on)
+                {
+                    const unsigned i = unsigned(__builtin_ctz(brackets));
+                    const unsigned upto = (2u << i) - 1u;
+                    pos += size_t(__builtin_popcount(non_ws & upto & ~done));
+                    done = upto;
+                    go_on = process(p + i);
+                    brackets &= brackets - 1;
+                }
+                if (go_on)
+                {
+                    pos += size_t(__builtin_popcount(non_ws & ~done));
+                    p += 16;
+                }
+            }
+        }
+#endif
+
+        while (go_on && p != end)
+        {
+            const unsigned char c_class = delimiters_.char_class(*p);
+            if (c_class != SPACE_CHAR && c_class != LEXER_SPACE)
+                ++pos;
+            if (c_class >= OPEN_BRACKET)
+                go_on = process(p);
+            ++p;
+        }
+
+        return go_on;
+    }
+
+protected:
+
+    /** @brief Delimiter sets larger than this are scanned byte by byte.*/
+    static const size_t MAX_SIMD_DELIMITERS = 16;
+
+    /**
+     * @brief States of the lexer.
+     * SLASH, BLOCK_STAR and the *_ESC states wait for the byte following the
+     * one at offset mark_.
+     */
+    enum LexerState
+    {
+        CODE,
+        SLASH,
+        LINE_COMMENT,
+        BLOCK_COMMENT,
+        BLOCK_STAR,
+        STRING,
+        STRING_ESC,
+        CHAR,
+        CHAR_ESC
+    };
+
+    /**
+     * @brief Process a marked byte through the lexer.
+     * Only the marked bytes are seen, so a pending state is resolved looking
+     * if this byte is adjacent to the previous one.
+     * @param c is the byte.
+     * @param offset is the byte's offset into the input.
+     * @return false if an unbalanced bracket was found.
+     */
+    bool process_char(char c, size_t offset)
+    {
+        if (lexer_ == CODE && delimiters_.char_class(c) <= CLOSE_BRACKET)
+            return process_bracket(c);
+
+        const bool adjacent = offset == mark_ + 1;
+        switch (lexer_)
+        {
+        case SLASH:
+            lexer_ = CODE;
+            if (adjacent && c == '/')
+            {
+                lexer_ = LINE_COMMENT;
+                return true;
+            }
+            if (adjacent && c == '*')
+            {
+                lexer_ = BLOCK_COMMENT;
+                return true;
+            }
+            break;
+        case BLOCK_STAR:
+            lexer_ = BLOCK_COMMENT;
+            if (adjacent && c == '/')
+            {
+                lexer_ = CODE;
+                return true;
+            }
+            break;
+        case STRING_ESC:
+            lexer_ = STRING;
+            if (adjacent)
+                return true;
+            break;
+        case CHAR_ESC:
+            lexer_ = CHAR;
+            if (adjacent)
+                return true;
+            break;
+        default:
+            break;
+        }
+
+        switch (lexer_)
+        {
+        case CODE:
+            if (delimiters_.char_class(c) <= CLOSE_BRACKET)
+            {
+                return process_bracket(c);
+            }
+            else if (c == '/')
+            {
+                lexer_ = SLASH;
+                mark_ = offset;
+            }
+            else if (c == '"')
+            {
+                lexer_ = STRING;
+            }
+            else if (c == '\'')
+            {
+                lexer_ = CHAR;
+            }
+            break;
+        case LINE_COMMENT:
+            if (c == '\n')
+                lexer_ = CODE;
+            break;
+        case BLOCK_COMMENT:
+            if (c == '*')
+            {
+                lexer_ = BLOCK_STAR;
+                mark_ = offset;
+            }
+            break;
+        case STRING:
+        case CHAR:
+            //A literal does not span lines, so a lone quote does not hide
+            //the rest of the input.
+            if (c == (lexer_ == STRING ? '"' : '\'') || c == '\n')
+            {
+                lexer_ = CODE;
+            }
+            else if (c == '\\')
+            {
+                lexer_ = (lexer_ == STRING) ? STRING_ESC : CHAR_ESC;
+                mark_ = offset;
+            }
+            break;
+        default:
+            break;
+        }
+        return true;
+    }
+
+    /**
+     * @brief Process the bracket at position pos_.
+     * @return false if it is unbalanced.
+     */
+    bool process_bracket(char c)
+    {
+        if (delimiters_.char_class(c) == OPEN_BRACKET)
+        {
+            stack_.push(Bracket(c, pos_));
+            ++depth_;
+        }
+        else if(stack_.is_empty() || !delimiters_.match(stack_.top().c(), c))
+        {
+            if (!sink_)
+            {
+                unbalanced_found_ = true;
+            }
+            else if (stack_.is_empty())
+            {
+                report(pos_, c, 0);
+            }
+            else
+            {
+                --depth_;
+                report(pos_, c, delimiters_.closing(stack_.top().c()));
+                stack_.pop();
+            }
+        }
+        else
+        {
+            stack_.pop();
+            --depth_;
+        }
+        return !unbalanced_found_;
+    }
+
+    /** @brief Send an error to the sink.*/
+    void report(size_t pos, char found, char expected)
+    {
+        if (n_errors_ == 0)
+            first_error_ = pos;
+        ++n_errors_;
+        sink_(BracketError{pos, found, expected, depth_});
+    }
+
+    Delimiters delimiters_;
+    Stack< Bracket, ArrayStackStorage<Bracket> > stack_;
+    size_t pos_;
+    bool unbalanced_found_;
+    LexerState lexer_;
+    /** @brief Offset of the next block into the input.*/
+    size_t offset_;
+    /** @brief Offset of the byte a pending lexer state waits after.*/
+    size_t mark_;
+    /** @brief Number of brackets open.*/
+    size_t depth_;
+    BracketErrorSink sink_;
+    size_t n_errors_;
+    size_t first_error_;
+    std::vector<char> buffer_;
+};
+
+template <class Delimiters>
+const size_t BasicBracketChecker<Delimiters>::BLOCK_SIZE;
+
+template <class Delimiters>
+const size_t BasicBracketChecker<Delimiters>::MAX_SIMD_DELIMITERS;
+
+/** @brief The checker of '()', '[]' and '{}'.*/
+typedef BasicBracketChecker<DefaultDelimiters> BracketChecker;
+
+#endif //__ED_BracketChecker_HPP__
@@ -1,47 +1,161 @@
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdio>
 #include <exception>
+#include <functional>
 #include <iostream>
+#include <mutex>
 #include <fstream>
+#include <stdexcept>
 #include <string>
+#include <thread>
+#include <vector>
 #include "check_brackets.hpp"
-#include "stack.hpp"
 
-class Bracket
+#if defined(__unix__) || defined(__APPLE__)
+#define __CHECK_BRACKETS_MMAP__
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace
 {
-public:
-    Bracket()
-        : _c(0), _pos(0)
-    {
-    }
-    Bracket(char c, size_t pos )
-        : _c(c), _pos(pos)
+
+/** @brief Size of the blocks read when the input is not memory mapped.*/
+const size_t BLOCK_SIZE = BracketChecker::BLOCK_SIZE;
+
+/** @brief Join a set of threads when leaving the scope, on every path.*/
+struct ThreadJoiner
+{
+    explicit ThreadJoiner(std::vector<std::thread>& threads_):
+        threads(threads_)
+    {}
+
+    ~ThreadJoiner()
     {
+        for (auto& t : threads)
+            if (t.joinable())
+                t.join();
     }
 
-    bool match_with(char o) const
+    std::vector<std::thread>& threads;
+};
+
+/** @brief Brackets of an input chunk that are not matched inside it.*/
+struct ChunkSummary
+{
+    /** @brief Unmatched closing brackets in input order.*/
+    std::vector<Bracket> closers;
+    /** @brief Unmatched opening brackets, the last one is the top.*/
+    std::vector<Bracket> openers;
+    /** @brief Number of non whitespace characters of the chunk.*/
+    size_t n_chars;
+    /**
+     * @brief Position of a closing bracket that does not match an opening
+     * bracket of the chunk, or 0. The chunk is not scanned beyond it.
+     */
+    size_t error_pos;
+};
+
+/**
+ * @brief Summarise the brackets of a chunk.
+ * Positions are relative to the chunk.
+ */
+void
+summarize_chunk(const char* data, size_t size, ChunkSummary& summary)
+{
+    const DefaultDelimiters delimiters;
+    const BracketChecker scanner;
+    size_t pos = 0;
+    summary.closers.clear();
+    summary.openers.clear();
+    summary.error_pos = 0;
+    scanner.scan(data, data + size, pos, [&](const char* at)
     {
-        return ( (_c == '{' && o == '}') ||
-                 (_c == '[' && o == ']') ||
-                 (_c == '(' && o == ')'));
-    }
-    size_t pos() const
+        const char c = *at;
+        if (delimiters.char_class(c) == OPEN_BRACKET)
+        {
+            summary.openers.push_back(Bracket(c, pos));
+        }
+        else if (summary.openers.empty())
+        {
+            summary.closers.push_back(Bracket(c, pos));
+        }
+        else if (summary.openers.back().match_with(c))
+        {
+            summary.openers.pop_back();
+        }
+        else
+        {
+            summary.error_pos = pos;
+        }
+        return summary.error_pos == 0;
+    });
+    summary.n_chars = pos;
+}
+
+/**
+ * @brief Merge the chunk summaries in input order.
+ * @return the same value check_brackets would return for the whole input.
+ */
+size_t
+merge_summaries(std::vector<ChunkSummary> const& summaries)
+{
+    std::vector<Bracket> stack;
+    size_t offset = 0;
+    size_t ret_val = 0;
+    bool unbalanced_found = false;
+
+    for (size_t i = 0; i < summaries.size() && !unbalanced_found; ++i)
     {
-        return _pos;
+        ChunkSummary const& summary = summaries[i];
+        for (size_t j = 0; j < summary.closers.size() && !unbalanced_found; ++j)
+        {
+            Bracket const& closer = summary.closers[j];
+            if (stack.empty() || !stack.back().match_with(closer.c()))
+            {
+                ret_val = offset + closer.pos();
+                unbalanced_found = true;
+            }
+            else
+            {
+                stack.pop_back();
+            }
+        }
+        if (!unbalanced_found && summary.error_pos != 0)
+        {
+            ret_val = offset + summary.error_pos;
+            unbalanced_found = true;
+        }
+        if (!unbalanced_found)
+        {
+            for (Bracket const& opener : summary.openers)
+            {
+                stack.push_back(Bracket(opener.c(), offset + opener.pos()));
+            }
+            offset += summary.n_chars;
+        }
     }
-    bool operator==(Bracket const& other) const
+
+    if (!unbalanced_found && !stack.empty())
     {
-        return _c==other._c && _pos==other._pos;
+        ret_val = stack.back().pos();
     }
-protected:
-    char _c;
-    size_t _pos;
-};
+    return ret_val;
+}
+
+} //namespace
 
 size_t
 check_brackets(std::istream& input)
 {
     size_t pos = 0;
     bool unbalanced_found = false;
-    auto stack = Stack<Bracket>::create();
+    auto stack = Stack< Bracket, ArrayStackStorage<Bracket> >::create();
     char next_c;
     while(input && !unbalanced_found)
     {
@@ -83,3 +197,270 @@ check_brackets(std::istream& input)
 
     return ret_val;
 }
+
+size_t
+check_brackets(const char* data, size_t size)
+{
+    BracketChecker checker;
+    checker.feed(data, size);
+    return checker.result();
+}
+
+size_t
+check_brackets_parallel(const char* data, size_t size, unsigned n_threads,
+                        size_t min_chunk_size)
+{
+    if (n_threads == 0)
+        n_threads = std::max(1u, std::thread::hardware_concurrency());
+    if (min_chunk_size == 0)
+        min_chunk_size = 1;
+    const size_t n_chunks = std::max<size_t>(1, std::min<size_t>(
+                                                 n_threads, size / min_chunk_size));
+
+    size_t ret_val = 0;
+    if (n_chunks == 1)
+    {
+        ret_val = check_brackets(data, size);
+    }
+    else
+    {
+        std::vector<ChunkSummary> summaries(n_chunks);
+        std::vector<std::exception_ptr> errors(n_chunks);
+        const size_t chunk_size = size / n_chunks;
+        {
+            //An exception of a worker is rethrown here once every thread
+            //is joined.
+            std::vector<std::thread> threads;
+            ThreadJoiner joiner (threads);
+            threads.reserve(n_chunks - 1);
+            for (size_t i = 1; i < n_chunks; ++i)
+            {
+                const size_t begin = i * chunk_size;
+                const size_t end = (i + 1 == n_chunks) ? size : begin + chunk_size;
+                threads.push_back(std::thread([&summaries, &errors, data, begin,
+                                              end, i]()
+                {
+                    try
+                    {
+                        summarize_chunk(data + begin, end - begin, summaries[i]);
+                    }
+                    catch (...)
+                    {
+                        errors[i] = std::current_exception();
+                    }
+                }));
+            }
+            summarize_chunk(data, chunk_size, summaries[0]);
+        }
+        for (auto const& error : errors)
+            if (error)
+                std::rethrow_exception(error);
+        ret_val = merge_summaries(summaries);
+    }
+    return ret_val;
+}
+
+size_t
+check_brackets_buffered(std::istream& input)
+{
+    BracketChecker checker;
+    std::vector<char> buffer(BLOCK_SIZE);
+    std::streambuf* sb = input.rdbuf();
+    std::streamsize n = 0;
+    do
+    {
+        n = sb->sgetn(buffer.data(), std::streamsize(buffer.size()));
+    }
+    while (n > 0 && checker.feed(buffer.data(), size_t(n)));
+    return checker.result();
+}
+
+size_t
+check_brackets_file(std::string const& filename, unsigned n_threads) noexcept(false)
+{
+    size_t ret_val = 0;
+    bool done = false;
+#ifdef __CHECK_BRACKETS_MMAP__
+    const int fd = ::open(filename.c_str(), O_RDONLY);
+    if (fd < 0)
+    {
+        throw std::runtime_error("could not open input filename '"
+                                 + filename + "'.");
+    }
+    struct stat st;
+    if (::fstat(fd, &st) == 0 && S_ISREG(st.st_mode))
+    {
+        const size_t size = size_t(st.st_size);
+        if (size == 0)
+        {
+            done = true;
+        }
+        else
+        {
+            void* data = ::mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+            if (data != MAP_FAILED)
+            {
+#ifdef MADV_SEQUENTIAL
+                ::madvise(data, size, MADV_SEQUENTIAL);
+#endif
+                ret_val = check_brackets_parallel(static_cast<const char*>(data),
+                                                  size, n_threads);
+                ::munmap(data, size);
+                done = true;
+            }
+        }
+    }
+    ::close(fd);
+#endif
+    if (!done)
+    {
+        //Not a regular file or it could not be mapped.
+        std::ifstream input (filename, std::ios::binary);
+        if (!input)
+        {
+            throw std::runtime_error("could not open input filename '"
+                                     + filename + "'.");
+        }
+        ret_val = check_brackets_buffered(input);
+    }
+    return ret_val;
+}
+
+namespace
+{
+
+/**
+ * @brief Run a batch with a checker for each thread.
+ * @see check_brackets_batch
+ */
+template <class Delimiters>
+BatchStats
+run_batch(std::vector<std::string> const& filenames, std::ostream& out,
+          unsigned n_threads, Delimiters const& delimiters)
+{
+    /** Result of a file.*/
+    struct FileResult
+    {
+        size_t pos;
+        std::string error;
+        bool done;
+    };
+
+    if (n_threads == 0)
+        n_threads = std::max(1u, std::thread::hardware_concurrency());
+    n_threads = unsigned(std::max<size_t>(1, std::min<size_t>(n_threads,
+                                                               filenames.size())));
+
+    auto start = std::chrono::steady_clock::now();
+    std::vector<FileResult> results(filenames.size(), FileResult{0, "", false});
+    std::atomic<size_t> next_file (0);
+    std::atomic<size_t> bytes (0);
+    std::mutex mutex;
+    std::condition_variable file_done;
+
+    auto worker = [&]()
+    {
+        BasicBracketChecker<Delimiters> checker (delimiters);
+        size_t i = next_file++;
+        while (i < filenames.size())
+        {
+            FileResult r{0, "", true};
+            try
+            {
+                size_t file_bytes = 0;
+                r.pos = checker.check_file(filenames[i], file_bytes);
+                bytes += file_bytes;
+            }
+            catch(std::exception &e)
+            {
+                r.error = e.what();
+            }
+            catch(...)
+            {
+                r.error = "unknown exception.";
+            }
+            {
+                std::lock_guard<std::mutex> lock (mutex);
+                results[i] = std::move(r);
+            }
+            file_done.notify_all();
+            i = next_file++;
+        }
+    };
+
+    //If writing to out throws, the workers end the remaining files and are
+    //joined before the exception leaves.
+    std::vector<std::thread> threads;
+    ThreadJoiner joiner (threads);
+    for (unsigned t = 0; t < n_threads; ++t)
+        threads.push_back(std::thread(worker));
+
+    BatchStats stats{filenames.size(), 0, 0, 0.0};
+    for (size_t i = 0; i < filenames.size(); ++i)
+    {
+        FileResult r;
+        {
+            std::unique_lock<std::mutex> lock (mutex);
+            file_done.wait(lock, [&]() { return results[i].done; });
+            r = results[i];
+        }
+        out << filenames[i] << ": ";
+        if (!r.error.empty())
+        {
+            out << "Error: " << r.error << '\n';
+            ++stats.failed;
+        }
+        else if (r.pos == 0)
+            out << "Success\n";
+        else
+            out << r.pos << '\n';
+    }
+    out.flush();
+
+    stats.bytes = bytes;
+    stats.seconds = std::chrono::duration<double>(
+                std::chrono::steady_clock::now() - start).count();
+    return stats;
+}
+
+} //namespace
+
+std::ostream&
+operator<<(std::ostream& out, BracketError const& error)
+{
+    out << error.pos << ": expected ";
+    if (error.expected == 0)
+        out << "nothing";
+    else
+        out << "'" << error.expected << "'";
+    out << " but found ";
+    if (error.found == 0)
+        out << "end of input";
+    else
+        out << "'" << error.found << "'";
+    out << " (depth " << error.depth << ")";
+    return out;
+}
+
+BatchStats
+check_brackets_batch(std::vector<std::string> const& filenames,
+                     std::ostream& out, unsigned n_threads)
+{
+    return run_batch(filenames, out, n_threads, DefaultDelimiters());
+}
+
+BatchStats
+check_brackets_batch(std::vector<std::string> const& filenames,
+                     std::ostream& out, unsigned n_threads,
+                     DelimiterSet const& delimiters)
+{
+    return run_batch(filenames, out, n_threads, delimiters);
+}
+
+BatchStats
+check_brackets_batch(std::vector<std::string> const& filenames,
+                     std::ostream& out, unsigned n_threads,
+                     SourceDelimiters<DelimiterSet> const& delimiters)
+{
+    return run_batch(filenames, out, n_threads, delimiters);
+}
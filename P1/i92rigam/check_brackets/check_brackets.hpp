@@ -1,5 +1,30 @@
 #ifndef __CHECK_BRAKETS_HPP__
+#define __CHECK_BRAKETS_HPP__
 #include <iostream>
+#include <string>
+#include <vector>
+#include "bracket_checker.hpp"
+
+/** @brief Aggregated figures of a batch run.*/
+struct BatchStats
+{
+    /** @brief Number of files processed.*/
+    size_t files;
+    /** @brief Number of files that could not be read.*/
+    size_t failed;
+    /** @brief Number of bytes read.*/
+    size_t bytes;
+    /** @brief Wall time in seconds.*/
+    double seconds;
+};
+
+/**
+ * @brief Write an error of the error collection mode.
+ * The line is "<pos>: expected '<c>' but found '<c>' (depth <n>)", using
+ * "nothing" for a bracket not expected and "end of input" for a bracket not
+ * closed.
+ */
+std::ostream& operator<<(std::ostream& out, BracketError const& error);
 
 /**
  * @brief Checks if the input stream has balanced brackets.
@@ -14,4 +39,99 @@
  */
 size_t check_brackets(std::istream& input);
 
+/**
+ * @brief Checks if a memory buffer has balanced brackets.
+ * @see check_brackets(std::istream&)
+ */
+size_t check_brackets(const char* data, size_t size);
+
+/**
+ * @brief Checks if a memory buffer has balanced brackets for a given set of
+ * delimiters.
+ * @see check_brackets(std::istream&)
+ */
+template <class Delimiters>
+size_t check_brackets(const char* data, size_t size, Delimiters const& delimiters)
+{
+    BasicBracketChecker<Delimiters> checker (delimiters);
+    checker.feed(data, size);
+    return checker.result();
+}
+
+/**
+ * @brief Checks if the input stream has balanced brackets reading it in
+ * large blocks.
+ * Unlike check_brackets(std::istream&), the characters are read from the
+ * stream buffer, so the stream's locale and skipws flag are not used.
+ * @see check_brackets(std::istream&)
+ */
+size_t check_brackets_buffered(std::istream& input);
+
+/**
+ * @brief Checks if a memory buffer has balanced brackets using several
+ * threads.
+ *
+ * The buffer is split into chunks that are summarised concurrently as
+ * (unmatched closing brackets, unmatched opening brackets). The summaries are
+ * merged in input order, so the result is the same as
+ * check_brackets(data, size).
+ *
+ * @param n_threads is the number of threads, 0 means one for each hardware
+ *        thread.
+ * @param min_chunk_size is the minimum size of a chunk, so small inputs use
+ *        less threads.
+ * @see check_brackets(std::istream&)
+ */
+size_t check_brackets_parallel(const char* data, size_t size,
+                               unsigned n_threads = 0,
+                               size_t min_chunk_size = 1 << 20);
+
+/**
+ * @brief Checks if a file has balanced brackets.
+ * The file is memory mapped when the platform allows it, otherwise it is read
+ * in large blocks.
+ * @param filename is the file's name.
+ * @param n_threads is the number of threads used for a memory mapped file.
+ * @warning throw std::runtime_error if the file could not be read.
+ * @see check_brackets(std::istream&)
+ * @see check_brackets_parallel
+ */
+size_t check_brackets_file(std::string const& filename,
+                           unsigned n_threads = 1) noexcept(false);
+
+/**
+ * @brief Checks a list of files using a pool of threads.
+ *
+ * Each thread keeps its own BracketChecker, so stacks and read buffers are
+ * reused between files. A line is written for each file in the input order:
+ * "<filename>: Success", "<filename>: <position>" or
+ * "<filename>: Error: <message>".
+ *
+ * @param filenames are the files to check.
+ * @param out is the output stream for the result lines.
+ * @param n_threads is the number of threads, 0 means one for each hardware
+ *        thread.
+ * @return the aggregated figures of the run.
+ */
+BatchStats check_brackets_batch(std::vector<std::string> const& filenames,
+                                std::ostream& out, unsigned n_threads = 0);
+
+/**
+ * @brief Checks a list of files using a pool of threads and a set of
+ * delimiters given at run time.
+ * @see check_brackets_batch(std::vector<std::string> const&, std::ostream&, unsigned)
+ */
+BatchStats check_brackets_batch(std::vector<std::string> const& filenames,
+                                std::ostream& out, unsigned n_threads,
+                                DelimiterSet const& delimiters);
+
+/**
+ * @brief Checks a list of source files using a pool of threads, skipping the
+ * brackets into string or char literals and comments.
+ * @see check_brackets_batch(std::vector<std::string> const&, std::ostream&, unsigned)
+ */
+BatchStats check_brackets_batch(std::vector<std::string> const& filenames,
+                                std::ostream& out, unsigned n_threads,
+                                SourceDelimiters<DelimiterSet> const& delimiters);
+
 #endif //__CHECK_BRAKETS_HPP__
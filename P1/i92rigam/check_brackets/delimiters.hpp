@@ -0,0 +1,333 @@
+#ifndef __ED_Delimiters_HPP__
+#define __ED_Delimiters_HPP__
+
+#include <cstddef>
+#include <stdexcept>
+#include <string>
+
+/** @brief Classes of the input bytes for the bracket checkers.*/
+enum CharClass
+{
+    OTHER_CHAR = 0,
+    SPACE_CHAR = 1,
+    OPEN_BRACKET = 2,
+    CLOSE_BRACKET = 3,
+    /** @brief A character that starts or ends a string literal or comment.*/
+    LEXER_CHAR = 4,
+    /** @brief A whitespace character that ends a line comment.*/
+    LEXER_SPACE = 5
+};
+
+/** @brief Is c a whitespace character of the "C" locale?*/
+constexpr bool is_c_space(unsigned char c)
+{
+    return c == ' ' || (c >= '\t' && c <= '\r');
+}
+
+/** @brief A list of indices 0, 1, ..., N-1 as a template parameter pack.*/
+template <size_t... I>
+struct IndexList
+{};
+
+template <size_t N, size_t... I>
+struct MakeIndexList : MakeIndexList<N - 1, N - 1, I...>
+{};
+
+template <size_t... I>
+struct MakeIndexList<0, I...>
+{
+    typedef IndexList<I...> type;
+};
+
+/**
+ * @brief Compile time classification of a byte given a list of pairs.
+ * Pairs is a sequence open_1, close_1, open_2, close_2, ...
+ */
+template <char... Pairs>
+struct DelimiterPairs;
+
+template <>
+struct DelimiterPairs<>
+{
+    static constexpr unsigned char char_class(unsigned char c)
+    {
+        return is_c_space(c) ? SPACE_CHAR : OTHER_CHAR;
+    }
+
+    static constexpr char partner(unsigned char)
+    {
+        return 0;
+    }
+
+    static constexpr char closing(unsigned char)
+    {
+        return 0;
+    }
+};
+
+template <char Open, char Close, char... Pairs>
+struct DelimiterPairs<Open, Close, Pairs...>
+{
+    static constexpr unsigned char char_class(unsigned char c)
+    {
+        return c == static_cast<unsigned char>(Open) ?
+                   static_cast<unsigned char>(OPEN_BRACKET) :
+               c == static_cast<unsigned char>(Close) ?
+                   static_cast<unsigned char>(CLOSE_BRACKET) :
+               DelimiterPairs<Pairs...>::char_class(c);
+    }
+
+    static constexpr char partner(unsigned char c)
+    {
+        return c == static_cast<unsigned char>(Close) ? Open :
+               DelimiterPairs<Pairs...>::partner(c);
+    }
+
+    static constexpr char closing(unsigned char c)
+    {
+        return c == static_cast<unsigned char>(Open) ? Close :
+               DelimiterPairs<Pairs...>::closing(c);
+    }
+};
+
+template <class Indices, char... Pairs>
+struct DelimiterTables;
+
+/** @brief The 256 entries tables of a list of pairs built at compile time.*/
+template <size_t... I, char... Pairs>
+struct DelimiterTables<IndexList<I...>, Pairs...>
+{
+    static constexpr unsigned char classes[sizeof...(I)] =
+        { DelimiterPairs<Pairs...>::char_class(static_cast<unsigned char>(I))... };
+    static constexpr char partners[sizeof...(I)] =
+        { DelimiterPairs<Pairs...>::partner(static_cast<unsigned char>(I))... };
+    static constexpr char closers[sizeof...(I)] =
+        { DelimiterPairs<Pairs...>::closing(static_cast<unsigned char>(I))... };
+};
+
+template <size_t... I, char... Pairs>
+constexpr unsigned char DelimiterTables<IndexList<I...>, Pairs...>::classes[sizeof...(I)];
+
+template <size_t... I, char... Pairs>
+constexpr char DelimiterTables<IndexList<I...>, Pairs...>::partners[sizeof...(I)];
+
+template <size_t... I, char... Pairs>
+constexpr char DelimiterTables<IndexList<I...>, Pairs...>::closers[sizeof...(I)];
+
+/**
+ * @brief A set of delimiter pairs fixed at compile time.
+ *
+ * The template parameters are the pairs as a sequence open_1, close_1,
+ * open_2, close_2, ... The classification and partner tables are constexpr,
+ * so classifying a byte is a single table lookup.
+ */
+template <char... Pairs>
+class StaticDelimiterSet
+{
+    static_assert(sizeof...(Pairs) % 2 == 0,
+                  "delimiters must be given as open/close pairs.");
+
+    typedef DelimiterTables<typename MakeIndexList<256>::type, Pairs...> Tables;
+
+public:
+
+    /** @brief Get the class of a byte.*/
+    unsigned char char_class(unsigned char c) const
+    {
+        return Tables::classes[c];
+    }
+
+    /** @brief Does close close open?*/
+    bool match(char open, char close) const
+    {
+        return Tables::partners[static_cast<unsigned char>(close)] == open;
+    }
+
+    /** @brief Get the closing bracket of open, or 0 if it is not one.*/
+    char closing(char open) const
+    {
+        return Tables::closers[static_cast<unsigned char>(open)];
+    }
+
+    /** @brief Number of delimiter characters.*/
+    static constexpr size_t size()
+    {
+        return sizeof...(Pairs);
+    }
+
+    /** @brief The delimiter characters, as open/close pairs.*/
+    const char* chars() const
+    {
+        return chars_;
+    }
+
+protected:
+
+    static constexpr char chars_[sizeof...(Pairs) + 1] = { Pairs..., '\0' };
+};
+
+template <char... Pairs>
+constexpr char StaticDelimiterSet<Pairs...>::chars_[sizeof...(Pairs) + 1];
+
+/** @brief The delimiters '()', '[]' and '{}'.*/
+typedef StaticDelimiterSet<'(', ')', '[', ']', '{', '}'> DefaultDelimiters;
+
+/**
+ * @brief A set of delimiter pairs given at run time.
+ * It has the same interface as StaticDelimiterSet.
+ */
+class DelimiterSet
+{
+public:
+
+    /**
+     * @brief Create a delimiter set.
+     * @param pairs are the delimiters as "open_1 close_1 open_2 close_2 ...",
+     *        without separators, for example "()[]{}<>".
+     * @warning throw std::runtime_error("Wrong delimiter set.") if pairs has
+     * an odd size, repeats a character or uses a whitespace character.
+     */
+    explicit DelimiterSet(std::string const& pairs = "()[]{}") noexcept(false)
+        : chars_(pairs)
+    {
+        if (pairs.size() % 2 != 0)
+            throw std::runtime_error("Wrong delimiter set.");
+        for (size_t i = 0; i < 256; ++i)
+        {
+            classes_[i] = is_c_space(static_cast<unsigned char>(i)) ? SPACE_CHAR
+                                                                    : OTHER_CHAR;
+            partners_[i] = 0;
+            closers_[i] = 0;
+        }
+        for (size_t i = 0; i < pairs.size(); ++i)
+        {
+            const unsigned char c = static_cast<unsigned char>(pairs[i]);
+            if (classes_[c] != OTHER_CHAR)
+                throw std::runtime_error("Wrong delimiter set.");
+            if (i % 2 == 0)
+            {
+                classes_[c] = OPEN_BRACKET;
+            }
+            else
+            {
+                classes_[c] = CLOSE_BRACKET;
+                partners_[c] = pairs[i - 1];
+                closers_[static_cast<unsigned char>(pairs[i - 1])] = pairs[i];
+            }
+        }
+    }
+
+    /** @brief Get the class of a byte.*/
+    unsigned char char_class(unsigned char c) const
+    {
+        return classes_[c];
+    }
+
+    /** @brief Does close close open?*/
+    bool match(char open, char close) const
+    {
+        return partners_[static_cast<unsigned char>(close)] == open;
+    }
+
+    /** @brief Get the closing bracket of open, or 0 if it is not one.*/
+    char closing(char open) const
+    {
+        return closers_[static_cast<unsigned char>(open)];
+    }
+
+    /** @brief Number of delimiter characters.*/
+    size_t size() const
+    {
+        return chars_.size();
+    }
+
+    /** @brief The delimiter characters, as open/close pairs.*/
+    const char* chars() const
+    {
+        return chars_.c_str();
+    }
+
+protected:
+
+    std::string chars_;
+    unsigned char classes_[256];
+    char partners_[256];
+    char closers_[256];
+};
+
+/**
+ * @brief A delimiter set that also classifies the characters delimiting
+ * string literals and comments.
+ *
+ * The quotes '"' and '\'', the comment characters '/' and '*', the escape
+ * character '\\' and the line end '\n' are marked, so a bracket checker can
+ * skip the brackets found into "...", '...', line comments and block
+ * comments.
+ * The tables are copied from the base set, so classifying a byte is still a
+ * single table lookup.
+ */
+template <class Base>
+class SourceDelimiters
+{
+public:
+
+    /**
+     * @brief Create a source delimiter set.
+     * @param base is the set of bracket pairs.
+     * @warning throw std::runtime_error("Wrong delimiter set.") if a bracket
+     * of base is a lexer character.
+     */
+    explicit SourceDelimiters(Base const& base = Base()) noexcept(false)
+        : base_(base), chars_(base.chars(), base.size())
+    {
+        const std::string lexer_chars = "\"'/*\\";
+        for (size_t i = 0; i < 256; ++i)
+            classes_[i] = base.char_class(static_cast<unsigned char>(i));
+        for (char c : lexer_chars)
+        {
+            if (classes_[static_cast<unsigned char>(c)] != OTHER_CHAR)
+                throw std::runtime_error("Wrong delimiter set.");
+            classes_[static_cast<unsigned char>(c)] = LEXER_CHAR;
+        }
+        classes_[static_cast<unsigned char>('\n')] = LEXER_SPACE;
+        chars_ += lexer_chars + "\n";
+    }
+
+    /** @brief Get the class of a byte.*/
+    unsigned char char_class(unsigned char c) const
+    {
+        return classes_[c];
+    }
+
+    /** @brief Does close close open?*/
+    bool match(char open, char close) const
+    {
+        return base_.match(open, close);
+    }
+
+    /** @brief Get the closing bracket of open, or 0 if it is not one.*/
+    char closing(char open) const
+    {
+        return base_.closing(open);
+    }
+
+    /** @brief Number of characters marked.*/
+    size_t size() const
+    {
+        return chars_.size();
+    }
+
+    /** @brief The delimiter characters followed by the lexer ones.*/
+    const char* chars() const
+    {
+        return chars_.c_str();
+    }
+
+protected:
+
+    Base base_;
+    std::string chars_;
+    unsigned char classes_[256];
+};
+
+#endif //__ED_Delimiters_HPP__
@@ -0,0 +1,699 @@
+#ifndef __ED_PooledSList_HPP__
+#define __ED_PooledSList_HPP__
+
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <memory>
+#include <vector>
+#include <utility>
+#include <stdexcept>
+#include <type_traits>
+#include <cassert>
+
+/**
+ * @brief a single link node stored into a SNodePool.
+ * The item lives in raw storage owned by the pool, so the link to the next
+ * node is a plain pointer and traversing it has no reference counting.
+ */
+template <class T>
+class PooledSNode
+{
+public:
+
+    /** @name Observers.*/
+    /** @{*/
+
+    /** @brief Get the data item.*/
+    const T& item() const
+    {
+        return *reinterpret_cast<const T*>(&storage_);
+    }
+
+    /**
+     * @brief Has it a next node?.
+     * @return true if it has a next node.
+    */
+    bool has_next() const
+    {
+        return next_ != nullptr;
+    }
+
+    /** @brief Get the link to next element.*/
+    PooledSNode<T>* next() const
+    {
+        return next_;
+    }
+
+    /** @}*/
+
+    /** @name Modifiers.*/
+    /** @{*/
+
+    /** @brief Set the data item.*/
+    void set_item(const T& new_it)
+    {
+        *reinterpret_cast<T*>(&storage_) = new_it;
+    }
+
+    /** @brief Set the link to the next node.*/
+    void set_next(PooledSNode<T>* next)
+    {
+        next_ = next;
+    }
+
+    /** @}*/
+
+protected:
+
+    template <class U, class Alloc> friend class SNodePool;
+
+    typename std::aligned_storage<sizeof(T), alignof(T)>::type storage_;
+    PooledSNode<T>* next_;
+};
+
+/**
+ * @brief A slab allocator of PooledSNode.
+ *
+ * Nodes are carved from slabs obtained through the allocator Alloc. The slab
+ * size grows geometrically up to max_slab_size nodes. Released nodes are kept
+ * in a free list and reused before asking the allocator for more memory.
+ * Slabs are only given back to the allocator when the pool is destroyed.
+ */
+template <class T, class Alloc = std::allocator<T> >
+class SNodePool
+{
+public:
+
+    typedef PooledSNode<T> Node;
+
+    /** @brief Nodes of the first slab.*/
+    static const size_t min_slab_size = 16;
+
+    /** @brief Upper bound for the nodes of a slab.*/
+    static const size_t max_slab_size = 4096;
+
+    /** @name Life cicle.*/
+    /** @{*/
+
+    /** @brief Create an empty pool.*/
+    SNodePool(Alloc const& alloc = Alloc())
+        : item_alloc_(alloc), node_alloc_(alloc), free_(nullptr),
+          next_slab_size_(min_slab_size)
+    {}
+
+    SNodePool(SNodePool const&) = delete;
+    SNodePool& operator=(SNodePool const&) = delete;
+
+    /**
+     * @brief Destroy the pool.
+     * @warning the items of the nodes still in use are not destroyed, the
+     * owner must release them before.
+     */
+    ~SNodePool()
+    {
+        for (auto const& slab : slabs_)
+        {
+            NodeAllocTraits::deallocate(node_alloc_, slab.first, slab.second);
+        }
+    }
+
+    /** @}*/
+
+    /** @name Modifiers.*/
+    /** @{*/
+
+    /**
+     * @brief Get a node from the pool.
+     * @param it the value save in the node.
+     * @param next link to the next node.
+     * @return the new node.
+     */
+    Node* acquire(T const& it, Node* next = nullptr)
+    {
+        return emplace(next, it);
+    }
+
+    /**
+     * @brief Get a node from the pool building the item in place.
+     * @param next link to the next node.
+     * @param args are the arguments of the item's constructor.
+     * @return the new node.
+     */
+    template <class... Args>
+    Node* emplace(Node* next, Args&&... args)
+    {
+        if (free_ == nullptr)
+        {
+            grow();
+        }
+        Node* node = free_;
+        ItemAllocTraits::construct(item_alloc_,
+                                   reinterpret_cast<T*>(&node->storage_),
+                                   std::forward<Args>(args)...);
+        free_ = node->next_;
+        node->next_ = next;
+        return node;
+    }
+
+    /**
+     * @brief Give back a node to the pool.
+     * @param node is the node to be released.
+     * @pre node was acquired from this pool.
+     */
+    void release(Node* node)
+    {
+        assert(node != nullptr);
+        ItemAllocTraits::destroy(item_alloc_,
+                                 reinterpret_cast<T*>(&node->storage_));
+        node->next_ = free_;
+        free_ = node;
+    }
+
+    /** @}*/
+
+protected:
+
+    typedef std::allocator_traits<Alloc> ItemAllocTraits;
+    typedef typename ItemAllocTraits::template rebind_alloc<Node> NodeAlloc;
+    typedef std::allocator_traits<NodeAlloc> NodeAllocTraits;
+
+    /** @brief Allocate a new slab and link its nodes into the free list.*/
+    void grow()
+    {
+        Node* slab = NodeAllocTraits::allocate(node_alloc_, next_slab_size_);
+        slabs_.push_back(std::make_pair(slab, next_slab_size_));
+        for (size_t i = next_slab_size_; i > 0; --i)
+        {
+            slab[i-1].next_ = free_;
+            free_ = &slab[i-1];
+        }
+        if (next_slab_size_ < max_slab_size)
+        {
+            next_slab_size_ *= 2;
+        }
+    }
+
+    Alloc item_alloc_;
+    NodeAlloc node_alloc_;
+    Node* free_;
+    size_t next_slab_size_;
+    std::vector< std::pair<Node*, size_t> > slabs_;
+};
+
+/**
+ * @brief ADT SList using pooled storage.
+ * Models a Single linked list[T] with the same interface of SList[T], but
+ * its nodes are taken from a SNodePool owned by the list instead of
+ * allocating a shared node per item.
+ */
+template<class T, class Alloc = std::allocator<T> >
+class PooledSList
+{
+  public:
+
+    /** @brief Define a shared reference to a PooledSList.
+     * Manages the storage of a pointer, providing a limited garbage-collection
+     * facility, possibly sharing that management with other objects.
+     * @see http://www.cplusplus.com/reference/memory/shared_ptr/
+     */
+    typedef std::shared_ptr< PooledSList<T, Alloc> > Ref;
+
+    typedef PooledSNode<T> Node;
+
+  /** @name Life cicle.*/
+  /** @{*/
+
+  /** @brief Create an empty list.
+   * @param alloc is the allocator used to get the node's slabs.
+   * @post is_empty()
+   */
+  PooledSList (Alloc const& alloc = Alloc())
+      : pool_(alloc), head_(nullptr), previous_(nullptr), current_(nullptr),
+        tail_(nullptr), size_(0)
+  {
+      assert(is_empty());
+  }
+
+  PooledSList(PooledSList const&) = delete;
+  PooledSList& operator=(PooledSList const&) = delete;
+
+  /** @brief Destroy the list.**/
+  ~PooledSList()
+  {
+      while (!is_empty())
+      {
+          pop_front();
+      }
+  }
+
+  /**
+   * @brief Create a PooledSList using dynamic memory.
+   * @return a shared referente to the new slist.
+   */
+  static typename PooledSList<T, Alloc>::Ref create()
+  {
+      return std::make_shared<PooledSList<T, Alloc>> ();
+  }
+
+  /**
+   * @brief Create a PooledSList unfoldig from an input stream.
+   *
+   * The input format will be "[]" for the empty list
+   * or "[" item1 item2 ... item_n "]" where item1 is the head.
+   *
+   * @param in is the input stream.
+   * @warning if the input format is not correct a std::runtime_error with
+   * what message "Wrong input format." will be reaised.
+   * @return A shared referente to the new slist.
+   */
+  static typename PooledSList<T, Alloc>::Ref create(std::istream& in) noexcept(false)
+  {
+      auto list = PooledSList<T, Alloc>::create();
+      std::string input;
+
+      in >> input;
+
+      if(input != "[]")
+      {
+          if(input != "[")
+          {
+              throw std::runtime_error("Wrong input format");
+          }
+          while (in >> input && input != "]")
+          {
+              std::istringstream inputstream(input);
+              T new_item;
+              inputstream>>new_item;
+              list->push_back(std::move(new_item));
+          }
+          if(input != "]")
+          {
+              throw std::runtime_error("Wrong input format");
+          }
+      }
+
+      return list;
+  }
+
+  /** @}*/
+
+  /** @name Observers*/
+
+  /** @{*/
+
+  /** @brief is the list empty?.*/
+  bool is_empty () const
+  {
+      return head_==nullptr;
+  }
+
+  /**
+   * @brief Get the head's item of the list.
+   * @return the item at the head.
+   */
+  const T& front() const
+  {
+      assert(!is_empty());
+      return head_->item();
+  }
+
+  /**
+   * @brief Get the last item of the list.
+   * @pre !is_empty()
+   */
+  const T& back() const
+  {
+      assert(!is_empty());
+      return tail_->item();
+  }
+
+  /** @brief Get the number of items.*/
+  size_t size() const
+  {
+      return size_;
+  }
+
+  /** @brief get the current item.
+   * @pre not is_empty()
+   */
+  const T& current() const
+  {
+      assert(! is_empty());
+      return current_->item();
+  }
+
+  /**
+   * @brief Is there a next item?
+   * @return true if there is.
+   * @pre !is_empty()
+   */
+  bool has_next() const
+  {
+      assert(!is_empty());
+      return current_->has_next();
+  }
+
+  /**
+   * @brief Get the next item.
+   * @return the next item data.
+   * @pre has_next()
+   */
+  T const& next() const
+  {
+      assert(has_next());
+      return current_->next()->item();
+  }
+
+  /**
+   * @brief Has it the item data?
+   * @param[in] it is the item to find.
+   * @return true if the item is into the list.
+   */
+  bool has(T const& it) const
+  {
+      Node const* iter = head_;
+      while (iter!=nullptr && !(iter->item()==it))
+      {
+          iter = iter->next();
+      }
+      return iter!=nullptr;
+  }
+
+  /**
+   * @brief Fold to an output stream.
+   *
+   * The format will be "[]" for the empty list or  '[' item1 item2 item3 ... item_n ']'
+   * where item1 is the head.
+   *
+   * @param out is the output stream.
+   */
+  void fold(std::ostream& out) const
+  {
+      out << "[";
+      if(!is_empty())
+      {
+          for (Node const* iter = head_; iter!=nullptr; iter=iter->next())
+          {
+              out << " " << iter->item();
+          }
+          out << " ";
+      }
+      out << "]";
+  }
+
+  /**@}*/
+
+  /** @name Modifiers*/
+
+  /** @{*/
+
+  /**
+   * @brief Set a new value for current.
+   * @param new_v is the new value.
+   * @pre !is_empty()
+   * @post item()==new_v
+   */
+  void set_current(T const& new_v)
+  {
+      assert(!is_empty());
+      current_->set_item(new_v);
+      assert(current()==new_v);
+  }
+
+  /**
+   * @brief insert an item as the new list's head.
+   * @param new_it is the item to insert.
+   * @post head()==new_it
+   */
+  void push_front(T const& new_it)
+  {
+      link_front(pool_.acquire(new_it, head_));
+      assert(front()==new_it);
+  }
+
+  /**
+   * @brief insert an item as the new list's head, moving it.
+   * @param new_it is the item to insert.
+   */
+  void push_front(T&& new_it)
+  {
+      emplace_front(std::move(new_it));
+  }
+
+  /**
+   * @brief insert an item built from args as the new list's head.
+   * @param args are the arguments of the item's constructor.
+   */
+  template <class... Args>
+  void emplace_front(Args&&... args)
+  {
+      link_front(pool_.emplace(head_, std::forward<Args>(args)...));
+  }
+
+  /**
+   * @brief insert an item as the new list's last item.
+   * The cursor is not moved.
+   * @param new_it is the item to insert.
+   * @post back()==new_it
+   */
+  void push_back(T const& new_it)
+  {
+      link_back(pool_.acquire(new_it));
+      assert(back()==new_it);
+  }
+
+  /**
+   * @brief insert an item as the new list's last item, moving it.
+   * @param new_it is the item to insert.
+   */
+  void push_back(T&& new_it)
+  {
+      link_back(pool_.emplace(nullptr, std::move(new_it)));
+  }
+
+  /**
+   * @brief insert a new item before current.
+   * @param new_it is the item to insert.
+   * @post old.is_empty() implies item()==head()==new_it
+   * @post !old.is_empty() implies item()==old.item() && has_next() && next()==new_it
+   */
+  void insert(T const& new_it)
+  {
+      if(is_empty())
+      {
+          push_front(new_it);
+      }
+      else
+      {
+          current_->set_next(pool_.acquire(new_it, current_->next()));
+          if(current_ == tail_)
+          {
+              tail_ = current_->next();
+          }
+          ++size_;
+      }
+      assert(has_next() || current()==new_it);
+  }
+
+  /**
+   * @brief Remove the head.
+   * @prec !is_empty()
+   * @post is_empty() || head() == "next of old.head()".
+   */
+  void pop_front()
+  {
+      assert(!is_empty());
+      Node* old_head = head_;
+      if(current_==head_)
+      {
+          current_=current_->next();
+      }
+      if(previous_==head_)
+      {
+          previous_=nullptr;
+      }
+      head_=head_->next();
+      if(head_==nullptr)
+      {
+          tail_=nullptr;
+      }
+      --size_;
+      pool_.release(old_head);
+  }
+
+  /**
+   * @brief Remove current item.
+   * @pre !is_empty()
+   * @post old.has_next() implies current()==old.next()
+   * @post !old.has_next() implies is_empty() || current()=="old previous item."
+   *
+   * Removing is O(1), but after removing the last item the link to the
+   * previous node of the new current is not known, so the next remove()
+   * from there looks for it from the head.
+   */
+  void remove()
+  {
+      assert(!is_empty());
+      if(current_==head_)
+      {
+          pop_front();
+      }
+      else
+      {
+          Node* old_current = current_;
+          if(previous_==nullptr || previous_->next()!=current_)
+          {
+              previous_=find_previous(current_);
+          }
+          previous_->set_next(current_->next());
+          if(current_->has_next())
+          {
+              current_=current_->next();
+          }
+          else
+          {
+              current_=previous_;
+              tail_=current_;
+              previous_=nullptr;
+          }
+          --size_;
+          pool_.release(old_current);
+      }
+  }
+
+  /**
+   * @brief Move the cursor to the next list's item.
+   * @pre has_next()
+   * @post old.next()==current()
+   */
+  void goto_next()
+  {
+      assert(has_next());
+      previous_=current_;
+      current_=current_->next();
+  }
+
+  /**
+   * @brief Move the cursor to the list's head.
+   * @pre !is_empty()
+   * @post current()==front()
+   */
+  void goto_first()
+  {
+      assert(!is_empty());
+      previous_=nullptr;
+      current_=head_;
+  }
+
+  /**
+   * @brief Move the cursor to the first occurrence of a value from the head of the list.
+   * If the item is not found, the cursor will be at the end of the list.
+   * @param it is the value to be found.
+   * @return true if it is found.
+   * @pre !is_empty()
+   * @post !ret_val || item()==it
+   * @post ret_value || !has_next()
+   */
+  bool find(T const& it)
+  {
+      assert(!is_empty());
+      previous_=nullptr;
+      current_=head_;
+      bool found = current_->item()==it;
+      while (!found && current_->has_next())
+      {
+          previous_=current_;
+          current_=current_->next();
+          found = current_->item()==it;
+      }
+      assert(!found || current()==it);
+      assert(found || !has_next());
+      return found;
+  }
+
+  /**
+   * @brief Move the cursor to the next occurrence of a value from current.
+   * If the item is not found, the cursor will be at the end of the list.
+   * @param it is the value to be found.
+   * @return true if it is found.
+   * @pre has_next()
+   * @post !ret_val || item()==it
+   * @post ret_value || !has_next()
+   */
+  bool find_next(T const& it)
+  {
+      assert(has_next());
+      bool found = false;
+      while (!found && current_->has_next())
+      {
+          previous_ = current_;
+          current_ = current_->next();
+          found = current_->item()==it;
+      }
+      assert(!found || current()==it);
+      assert(found || !has_next());
+      return found;
+  }
+
+  /** @}*/
+
+protected:
+
+  /** @brief Link a node, whose next is the head, as the new head.*/
+  void link_front(Node* new_node)
+  {
+      if(current_ == head_)
+      {
+          current_ = new_node;
+      }
+      if(tail_ == nullptr)
+      {
+          tail_ = new_node;
+      }
+      head_ = new_node;
+      ++size_;
+  }
+
+  /** @brief Link a node without next as the new last node.*/
+  void link_back(Node* new_node)
+  {
+      if(is_empty())
+      {
+          link_front(new_node);
+      }
+      else
+      {
+          tail_->set_next(new_node);
+          tail_ = new_node;
+          ++size_;
+      }
+  }
+
+  /**
+   * @brief Find the node linking to a given node.
+   * @return the previous node or nullptr if node is the head.
+   */
+  Node* find_previous(Node const* node) const
+  {
+      Node* prev = nullptr;
+      if (node != head_)
+      {
+          prev = head_;
+          while (prev->next()!=node)
+          {
+              prev = prev->next();
+          }
+      }
+      return prev;
+  }
+
+  SNodePool<T, Alloc> pool_;
+  Node* head_;
+  Node* previous_;
+  Node* current_;
+  Node* tail_;
+  size_t size_;
+};
+
+#endif //__ED_PooledSList_HPP__
@@ -6,6 +6,7 @@
 #include <string>
 #include <memory>
 #include <stdexcept>
+#include <utility>
 #include <cassert>
 
 /** @brief a single link node.*/
@@ -21,6 +22,10 @@ public:
      */
     typedef std::shared_ptr< SNode<T> > Ref;
 
+    /** @brief Tag to build the item in place from constructor arguments.*/
+    struct Emplace
+    {};
+
     /** @name Life cicle.*/
     /** @{*/
 
@@ -28,17 +33,28 @@ public:
      * @post !has_next()
      */
     SNode (T const& it)
+        : it_(it), next_(nullptr)
     {
-        it_ = it;
-        next_ = nullptr;
         assert(!has_next());
     }
 
-    /** @brief Create an empty Stack.*/
-    SNode (T const& it, SNode<T>::Ref& next)
+    /** @brief Create a node linked to next.*/
+    SNode (T const& it, SNode<T>::Ref next)
+        : it_(it), next_(std::move(next))
+    {
+    }
+
+    /** @brief Create a node moving the item.*/
+    SNode (T&& it, SNode<T>::Ref next)
+        : it_(std::move(it)), next_(std::move(next))
+    {
+    }
+
+    /** @brief Create a node building the item from args.*/
+    template <class... Args>
+    SNode (Emplace, SNode<T>::Ref next, Args&&... args)
+        : it_(std::forward<Args>(args)...), next_(std::move(next))
     {
-        it_ = it;
-        next_ = next;
     }
 
     /**
@@ -49,7 +65,29 @@ public:
      */
     static typename SNode<T>::Ref create(T const& it, SNode<T>::Ref next=nullptr)
     {
-        return std::make_shared<SNode<T>> (it, next);
+        return std::make_shared<SNode<T>> (it, std::move(next));
+    }
+
+    /**
+     * @brief Create a SNode using dynamic memory, moving the item.
+     * @see create(T const&, SNode<T>::Ref)
+     */
+    static typename SNode<T>::Ref create(T&& it, SNode<T>::Ref next=nullptr)
+    {
+        return std::make_shared<SNode<T>> (std::move(it), std::move(next));
+    }
+
+    /**
+     * @brief Create a SNode using dynamic memory, building the item in place.
+     * @param next link to the next node.
+     * @param args are the arguments of the item's constructor.
+     * @return a shared referente to the new node.
+     */
+    template <class... Args>
+    static typename SNode<T>::Ref emplace(SNode<T>::Ref next, Args&&... args)
+    {
+        return std::make_shared<SNode<T>> (Emplace(), std::move(next),
+                                           std::forward<Args>(args)...);
     }
 
     /** @brief Destroy a SNode.**/
@@ -94,10 +132,16 @@ public:
         it_=new_it;
     }
 
+    /** @brief Set the data item moving it.*/
+    void set_item(T&& new_it)
+    {
+        it_=std::move(new_it);
+    }
+
     /** @brief Set the link to the next node.*/
     void set_next(SNode<T>::Ref next)
     {
-        next_=next;
+        next_=std::move(next);
     }
 
 protected:
@@ -109,6 +153,9 @@ protected:
 /**
  * @brief ADT SList.
  * Models a Single linked list[T].
+ *
+ * The list keeps a link to its last node and its size, so push_back() and
+ * size() are O(1).
  */
 template<class T>
 class SList
@@ -133,12 +180,24 @@ class SList
       head_=nullptr;
       current_=nullptr;
       previous_=nullptr;
+      tail_=nullptr;
+      size_=0;
       assert(is_empty());
   }
 
   /** @brief Destroy a Stack.**/
   ~SList()
-  {}
+  {
+      //Release the nodes not shared one by one, a long chain of shared
+      //links would be destroyed recursively.
+      previous_=nullptr;
+      current_=nullptr;
+      tail_=nullptr;
+      while (head_!=nullptr && head_.use_count()==1)
+      {
+          head_=head_->next();
+      }
+  }
 
   /**
    * @brief Create a SList using dynamic memory.
@@ -163,8 +222,6 @@ class SList
   static typename SList<T>::Ref create(std::istream& in) noexcept(false)
   {
       auto list = SList<T>::create();
-      auto reversed_list = SList<T>::create();
-      T new_item;
       std::string input;
 
       in >> input;
@@ -178,13 +235,9 @@ class SList
           while (in >> input && input != "]")
           {
               std::istringstream inputstream(input);
+              T new_item;
               inputstream>>new_item;
-              reversed_list->push_front(new_item);
-          }
-          while (!reversed_list->is_empty())
-          {
-              list->push_front(reversed_list->front());
-              reversed_list->pop_front();
+              list->push_back(std::move(new_item));
           }
           if(input != "]")
           {
@@ -207,6 +260,12 @@ class SList
       return head_==nullptr;
   }
 
+  /** @brief Get the number of items.*/
+  size_t size() const
+  {
+      return size_;
+  }
+
   /**
    * @brief Get the head's item of the list.
    * @return the item at the head.
@@ -217,6 +276,16 @@ class SList
       return head_->item();
   }
 
+  /**
+   * @brief Get the last item of the list.
+   * @pre !is_empty()
+   */
+  const T& back() const
+  {
+      assert(!is_empty());
+      return tail_->item();
+  }
+
   /** @brief get the current item.
    * @pre not is_empty()
    */
@@ -326,15 +395,50 @@ class SList
    */
   void push_front(T const& new_it)
   {
-      auto new_node = SNode<T>::create(new_it, head_);
-      if(current_ == head_)
-      {
-          current_ = new_node;
-      }
-      head_ = new_node;
+      link_front(SNode<T>::create(new_it, head_));
       assert(front()==new_it);
   }
 
+  /**
+   * @brief insert an item as the new list's head, moving it.
+   * @param new_it is the item to insert.
+   */
+  void push_front(T&& new_it)
+  {
+      link_front(SNode<T>::create(std::move(new_it), head_));
+  }
+
+  /**
+   * @brief insert an item built from args as the new list's head.
+   * @param args are the arguments of the item's constructor.
+   */
+  template <class... Args>
+  void emplace_front(Args&&... args)
+  {
+      link_front(SNode<T>::emplace(head_, std::forward<Args>(args)...));
+  }
+
+  /**
+   * @brief insert an item as the new list's last item.
+   * The cursor is not moved.
+   * @param new_it is the item to insert.
+   * @post back()==new_it
+   */
+  void push_back(T const& new_it)
+  {
+      link_back(SNode<T>::create(new_it));
+      assert(back()==new_it);
+  }
+
+  /**
+   * @brief insert an item as the new list's last item, moving it.
+   * @param new_it is the item to insert.
+   */
+  void push_back(T&& new_it)
+  {
+      link_back(SNode<T>::create(std::move(new_it)));
+  }
+
 
   /**
    * @brief insert a new item before current.
@@ -359,6 +463,11 @@ class SList
       {
           auto new_node = SNode<T>::create(new_it, current_->next());
           current_->set_next(new_node);
+          if(current_ == tail_)
+          {
+              tail_ = new_node;
+          }
+          ++size_;
       }
 
       assert(!old_is_empty || (front()==new_it && current()==new_it));
@@ -377,7 +486,16 @@ class SList
       {
           current_=current_->next();
       }
+      if(previous_==head_)
+      {
+          previous_=nullptr;
+      }
       head_=head_->next();
+      if(head_==nullptr)
+      {
+          tail_=nullptr;
+      }
+      --size_;
   }
 
 
@@ -386,6 +504,10 @@ class SList
    * @pre !is_empty()
    * @post old.has_next() implies current()==old.next()
    * @post !old.has_next() implies is_empty() || current()=="old previous item."
+   *
+   * Removing is O(1), but after removing the last item the link to the
+   * previous node of the new current is not known, so the next remove()
+   * from there looks for it from the head.
    */
   void remove()
   {
@@ -403,16 +525,22 @@ class SList
       }
       else
       {
+          if(previous_==nullptr || previous_->next()!=current_)
+          {
+              previous_=find_previous(current_);
+          }
+          previous_->set_next(current_->next());
           if(current_->has_next())
           {
-              previous_->set_next(current_->next());
               current_=current_->next();
           }
           else
           {
-              find(previous_->item());
-              current_->set_next(nullptr);
+              current_=previous_;
+              tail_=current_;
+              previous_=nullptr;
           }
+          --size_;
       }
 
       assert(!old_has_next || current()==old_next);
@@ -459,20 +587,15 @@ class SList
   bool find(T const& it)
   {
       assert(!is_empty());
-      bool found = false;
+      previous_=nullptr;
       current_=head_;
-      do
+      bool found = current_->item()==it;
+      while (!found && current_->has_next())
       {
-          if(current_->item()==it)
-          {
-              found=true;
-          }
-          else
-          {
-              previous_=current_;
-              current_=current_->next();
-          }
-      }while (current_->has_next() && !found);
+          previous_=current_;
+          current_=current_->next();
+          found = current_->item()==it;
+      }
 
 
       assert(!found || current()==it);
@@ -514,9 +637,59 @@ class SList
 
 protected:
 
+  /** @brief Link a node, whose next is the head, as the new head.*/
+  void link_front(typename SNode<T>::Ref new_node)
+  {
+      if(current_ == head_)
+      {
+          current_ = new_node;
+      }
+      if(tail_ == nullptr)
+      {
+          tail_ = new_node;
+      }
+      head_ = std::move(new_node);
+      ++size_;
+  }
+
+  /** @brief Link a node without next as the new last node.*/
+  void link_back(typename SNode<T>::Ref new_node)
+  {
+      if(is_empty())
+      {
+          link_front(std::move(new_node));
+      }
+      else
+      {
+          tail_->set_next(new_node);
+          tail_ = std::move(new_node);
+          ++size_;
+      }
+  }
+
+  /**
+   * @brief Find the node linking to a given node.
+   * @return the previous node or nullptr if node is the head.
+   */
+  typename SNode<T>::Ref find_previous(typename SNode<T>::Ref const& node) const
+  {
+      typename SNode<T>::Ref prev;
+      if (node != head_)
+      {
+          prev = head_;
+          while (prev->next()!=node)
+          {
+              prev = prev->next();
+          }
+      }
+      return prev;
+  }
+
   typename SNode<T>::Ref head_;
   typename SNode<T>::Ref previous_;
   typename SNode<T>::Ref current_;
+  typename SNode<T>::Ref tail_;
+  size_t size_;
 };
 
 #endif //ED_SList
@@ -3,13 +3,214 @@
 
 #include <cassert>
 #include <iostream>
+#include <memory>
+#include <new>
+#include <type_traits>
+#include <utility>
+#include <vector>
 #include "slist.hpp"
 
 /**
- * @brief ADT Stack.
- * Models a Stack using a single linked list*
+ * @brief Stack storage using a single linked list.
+ * Each push allocates a node. This is the default storage of Stack.
  */
 template<class T>
+class SListStackStorage
+{
+  public:
+
+  bool is_empty() const
+  {
+      return list_.is_empty();
+  }
+
+  const T& top() const
+  {
+      return list_.front();
+  }
+
+  void push(const T& new_it)
+  {
+      list_.push_front(new_it);
+  }
+
+  void push(T&& new_it)
+  {
+      list_.push_front(std::move(new_it));
+  }
+
+  template <class... Args>
+  void emplace(Args&&... args)
+  {
+      list_.emplace_front(std::forward<Args>(args)...);
+  }
+
+  void pop()
+  {
+      list_.pop_front();
+  }
+
+  void fold(std::ostream& out) const
+  {
+      list_.fold(out);
+  }
+
+protected:
+
+  SList<T> list_;
+};
+
+/**
+ * @brief Stack storage using a contiguous array.
+ * The first N items are saved inline in the storage, so shallow stacks never
+ * use dynamic memory. Beyond that, items are moved to a heap buffer that
+ * doubles its capacity each time it gets full. The buffer is kept when
+ * popping, so a reused stack does not allocate again.
+ */
+template<class T, size_t N=16>
+class ArrayStackStorage
+{
+  public:
+
+  ArrayStackStorage()
+      : data_(inline_data()), size_(0), capacity_(N)
+  {}
+
+  ArrayStackStorage(ArrayStackStorage const&) = delete;
+  ArrayStackStorage& operator=(ArrayStackStorage const&) = delete;
+
+  ~ArrayStackStorage()
+  {
+      while (size_ > 0)
+          pop();
+      if (data_ != inline_data())
+          std::allocator<T>().deallocate(data_, capacity_);
+  }
+
+  bool is_empty() const
+  {
+      return size_ == 0;
+  }
+
+  /** @brief Number of items that fit without reallocating.*/
+  size_t capacity() const
+  {
+      return capacity_;
+  }
+
+  const T& top() const
+  {
+      return data_[size_-1];
+  }
+
+  void push(const T& new_it)
+  {
+      emplace(new_it);
+  }
+
+  void push(T&& new_it)
+  {
+      emplace(std::move(new_it));
+  }
+
+  template <class... Args>
+  void emplace(Args&&... args)
+  {
+      if (size_ == capacity_)
+      {
+          //The new item is built before moving the others, as args could
+          //refer to one of them.
+          const size_t new_capacity = 2 * capacity_;
+          T* new_data = std::allocator<T>().allocate(new_capacity);
+          try
+          {
+              ::new (static_cast<void*>(new_data + size_))
+                      T(std::forward<Args>(args)...);
+          }
+          catch (...)
+          {
+              std::allocator<T>().deallocate(new_data, new_capacity);
+              throw;
+          }
+          relocate(new_data, new_capacity);
+      }
+      else
+      {
+          ::new (static_cast<void*>(data_ + size_)) T(std::forward<Args>(args)...);
+      }
+      ++size_;
+  }
+
+  void pop()
+  {
+      --size_;
+      data_[size_].~T();
+  }
+
+  void fold(std::ostream& out) const
+  {
+      out << "[";
+      if (size_ > 0)
+      {
+          for (size_t i = size_; i > 0; --i)
+              out << " " << data_[i-1];
+          out << " ";
+      }
+      out << "]";
+  }
+
+protected:
+
+  T* inline_data()
+  {
+      return reinterpret_cast<T*>(&inline_);
+  }
+
+  /**
+   * @brief Move the items to a new heap buffer.
+   * new_data[size_] already holds the new item. If an item copy throws, the
+   * items built into new_data are destroyed, new_data is released and the
+   * old buffer is left untouched.
+   */
+  void relocate(T* new_data, size_t new_capacity)
+  {
+      size_t i = 0;
+      try
+      {
+          for (; i < size_; ++i)
+              ::new (static_cast<void*>(new_data + i)) T(std::move_if_noexcept(data_[i]));
+      }
+      catch (...)
+      {
+          for (size_t j = 0; j < i; ++j)
+              new_data[j].~T();
+          new_data[size_].~T();
+          std::allocator<T>().deallocate(new_data, new_capacity);
+          throw;
+      }
+      for (i = 0; i < size_; ++i)
+          data_[i].~T();
+      if (data_ != inline_data())
+          std::allocator<T>().deallocate(data_, capacity_);
+      data_ = new_data;
+      capacity_ = new_capacity;
+  }
+
+  typename std::aligned_storage<sizeof(T) * N, alignof(T)>::type inline_;
+  T* data_;
+  size_t size_;
+  size_t capacity_;
+};
+
+/**
+ * @brief ADT Stack.
+ * Models a Stack of T.
+ *
+ * The Storage policy chooses the representation: SListStackStorage (a single
+ * linked list, the default) or ArrayStackStorage (a contiguous array with
+ * inline capacity).
+ */
+template<class T, class Storage = SListStackStorage<T> >
 class Stack
 {
   public:
@@ -18,7 +219,7 @@ class Stack
      * facility, possibly sharing that management with other objects.
      * @see http://www.cplusplus.com/reference/memory/shared_ptr/
      */
-    typedef std::shared_ptr< Stack<T> > Ref;
+    typedef std::shared_ptr< Stack<T, Storage> > Ref;
 
   /** @name Life cicle.*/
   /** @{*/
@@ -28,7 +229,6 @@ class Stack
    */
   Stack ()
   {
-      SList<T>::create();
       assert(is_empty());
   }
 
@@ -36,22 +236,33 @@ class Stack
    * @brief Create a Stack using dynamic memory.
    * @return a shared referente to the new stack.
    */
-  static typename Stack<T>::Ref create()
+  static typename Stack<T, Storage>::Ref create()
   {
-      return std::make_shared<Stack<T>>();
+      return std::make_shared<Stack<T, Storage>>();
   }
 
   /**
    * @brief Create a Stack from an input stream.
-   * The input format is the same of a single list.
+   * The input format is the same of a single list, where item1 is the top.
    * @return a shared referente to the new stack.
    * @warning throw std::runtime_error if wrong input format.
    */
-  static typename Stack<T>::Ref create(std::istream & in) noexcept(false)
+  static typename Stack<T, Storage>::Ref create(std::istream & in) noexcept(false)
   {
-      auto stack = Stack<T>::create();
+      auto stack = Stack<T, Storage>::create();
+      auto list = SList<T>::create(in);
+      std::vector<T> items;
 
-      stack = SList<T>::create(in);
+      while (!list->is_empty())
+      {
+          items.push_back(list->front());
+          list->pop_front();
+      }
+      while (!items.empty())
+      {
+          stack->push(std::move(items.back()));
+          items.pop_back();
+      }
 
       return stack;
   }
@@ -69,7 +280,7 @@ class Stack
   /** @brief is the list empty?.*/
   bool is_empty () const
   {
-      return list_.is_empty();
+      return storage_.is_empty();
   }
 
   /** @brief get the top item.
@@ -78,7 +289,7 @@ class Stack
   const T& top() const
   {
       assert(! is_empty());
-      return list_.front();
+      return storage_.top();
   }
 
   /**
@@ -88,11 +299,9 @@ class Stack
    */
   void fold(std::ostream& out) const
   {
-      list_.fold(out);
+      storage_.fold(out);
   }
 
-  /**
-
   /**@}*/
 
   /** @name Modifiers*/
@@ -104,9 +313,28 @@ class Stack
    */
   void push(const T& new_it)
   {
-      list_.push_front(new_it);
+#ifndef NDEBUG
+      //new_it could be an item moved by the storage.
+      const T pushed_it = new_it;
+#endif
+      storage_.push(new_it);
 
-      assert(top()==new_it);
+      assert(top()==pushed_it);
+  }
+
+  /** @brief Insert a new item moving it.*/
+  void push(T&& new_it)
+  {
+      storage_.push(std::move(new_it));
+  }
+
+  /** @brief Insert a new item built from args.
+   * @param args are the arguments of the item's constructor.
+   */
+  template <class... Args>
+  void emplace(Args&&... args)
+  {
+      storage_.emplace(std::forward<Args>(args)...);
   }
 
   /** Remove the top item.
@@ -115,15 +343,14 @@ class Stack
   void pop()
   {
       assert(! is_empty());
-      list_.pop_front();
-
+      storage_.pop();
   }
 
   /** @} */
 
 protected:
 
-  SList<T> list_;
+  Storage storage_;
 
 };
 
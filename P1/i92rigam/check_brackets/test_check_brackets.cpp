@@ -1,28 +1,320 @@
+#include <algorithm>
+#include <cctype>
+#include <cstdlib>
 #include <exception>
 #include <iostream>
 #include <fstream>
+#include <iterator>
+#include <limits>
+#include <memory>
+#include <stdexcept>
 #include <string>
+#include <vector>
 #include "check_brackets.hpp"
 
+void
+usage()
+{
+    std::cerr << "Usage: check_brackets [--source] [--all] [--parallel] [--delimiters pairs]"
+              << " filename" << std::endl;
+    std::cerr << "       check_brackets [--source] [--delimiters pairs] --batch"
+              << " [-j n_threads] [filename ...]" << std::endl;
+    std::cerr << "--source skips the brackets into string or char literals"
+              << " and comments." << std::endl;
+    std::cerr << "--all reports every unbalanced bracket, one per line."
+              << " It can not be used with --batch."
+              << std::endl;
+    std::cerr << "--parallel checks the file split into 1, 2, ..., n one byte"
+              << " or longer chunks." << std::endl;
+}
+
+/**
+ * @brief Check a file with check_brackets_parallel for every chunk count.
+ * The file is split into 1, 2, ..., size chunks (at most 64) so the merge of
+ * the chunk summaries is exercised at every boundary.
+ * @return the position given by check_brackets.
+ * @warning throw std::runtime_error if a chunk count gives other position.
+ */
+size_t
+check_all_chunkings(std::string const& filename)
+{
+    std::ifstream input (filename, std::ios::binary);
+    const std::string data ((std::istreambuf_iterator<char>(input)),
+                            std::istreambuf_iterator<char>());
+    const size_t expected = check_brackets(data.data(), data.size());
+    const size_t max_chunks = std::min<size_t>(64, std::max<size_t>(1, data.size()));
+    for (size_t n = 1; n <= max_chunks; ++n)
+    {
+        const size_t pos = check_brackets_parallel(data.data(), data.size(),
+                                                   unsigned(n), 1);
+        if (pos != expected)
+        {
+            throw std::runtime_error("with " + std::to_string(n)
+                                     + " chunks got " + std::to_string(pos)
+                                     + " but expected "
+                                     + std::to_string(expected) + ".");
+        }
+    }
+    return expected;
+}
+
+/**
+ * @brief Check a file writing a line for each unbalanced bracket.
+ * @return the number of errors.
+ */
+template <class Delimiters>
+size_t
+report_all_errors(std::string const& filename, Delimiters const& delimiters)
+{
+    BasicBracketChecker<Delimiters> checker (delimiters);
+    checker.collect_errors([](BracketError const& error)
+    {
+        std::cout << error << '\n';
+    });
+    size_t bytes = 0;
+    checker.check_file(filename, bytes);
+    return checker.n_errors();
+}
+
+/**
+ * @brief Check a file whose first line lists the delimiter pairs, as
+ * --delimiters takes them, and the rest is the input.
+ * @return the position given by check_brackets, relative to the input.
+ * @warning throw std::runtime_error("Wrong delimiter set.") if the pairs
+ * are wrong.
+ */
+size_t
+check_listed_delimiters(std::string const& filename)
+{
+    std::ifstream input (filename, std::ios::binary);
+    std::string pairs;
+    std::getline(input, pairs);
+    const DelimiterSet delimiters (pairs);
+    const std::string data ((std::istreambuf_iterator<char>(input)),
+                            std::istreambuf_iterator<char>());
+    return check_brackets(data.data(), data.size(), delimiters);
+}
+
+/**
+ * @brief Batch mode.
+ * Usage: check_brackets [--source] [--delimiters pairs] --batch [-j n_threads] [filename ...]
+ * If no filenames are given, they are read from the manifest, one per line.
+ * @param args are the arguments following "--batch".
+ * @param delimiters are the delimiters given by the user or nullptr.
+ * @param source is true to skip literals and comments.
+ * @param manifest is the list of filenames, the standard input by default.
+ * @param timing is false to report the files checked without the times, so
+ *        the report can be compared with an expected one.
+ */
+int
+batch_main(std::vector<std::string> args, DelimiterSet const* delimiters,
+           bool source, std::istream& manifest = std::cin, bool timing = true)
+{
+    unsigned n_threads = 0;
+    std::vector<std::string> filenames;
+    size_t arg = 0;
+    if (arg < args.size() && args[arg] == "-j")
+    {
+        const std::string value = (arg + 1 < args.size()) ? args[arg + 1] : "";
+        char* end = nullptr;
+        const unsigned long n = std::strtoul(value.c_str(), &end, 10);
+        if (value.empty() || *end != '\0' || !std::isdigit(value[0])
+                || n > std::numeric_limits<unsigned>::max())
+        {
+            std::cerr << "Error: wrong number of threads '" << value << "'."
+                      << std::endl;
+            usage();
+            return EXIT_FAILURE;
+        }
+        n_threads = unsigned(n);
+        arg += 2;
+    }
+    for (; arg < args.size(); ++arg)
+    {
+        filenames.push_back(args[arg]);
+    }
+    if (filenames.empty())
+    {
+        std::string line;
+        while (std::getline(manifest, line))
+        {
+            if (!line.empty())
+                filenames.push_back(line);
+        }
+    }
+
+    BatchStats stats;
+    if (source)
+    {
+        const DelimiterSet pairs = (delimiters == nullptr) ? DelimiterSet()
+                                                           : *delimiters;
+        stats = check_brackets_batch(filenames, std::cout, n_threads,
+                                     SourceDelimiters<DelimiterSet>(pairs));
+    }
+    else if (delimiters == nullptr)
+    {
+        stats = check_brackets_batch(filenames, std::cout, n_threads);
+    }
+    else
+    {
+        stats = check_brackets_batch(filenames, std::cout, n_threads, *delimiters);
+    }
+
+    if (!timing)
+    {
+        std::cout << "Checked " << stats.files << " files ("
+                  << stats.failed << " failed), " << stats.bytes << " bytes."
+                  << std::endl;
+        return stats.failed == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+    }
+    std::cerr << "Checked " << stats.files << " files ("
+              << stats.failed << " failed), " << stats.bytes << " bytes in "
+              << stats.seconds << " s: "
+              << stats.files / stats.seconds << " files/s, "
+              << (stats.bytes / (1024.0 * 1024.0)) / stats.seconds
+              << " MB/s." << std::endl;
+    return stats.failed == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
 int
 main(int argc, const char* argv[])
 {
     int exit_code = EXIT_SUCCESS;
     try
     {
-        if (argc != 2)
+        std::vector<std::string> args (argv + 1, argv + argc);
+        std::unique_ptr<DelimiterSet> delimiters;
+#ifdef __SOURCE_BRACKETS__
+        bool source = true;
+#else
+        bool source = false;
+#endif
+#ifdef __ALL_BRACKETS__
+        bool all = true;
+#else
+        bool all = false;
+#endif
+#ifdef __PARALLEL_BRACKETS__
+        bool parallel = true;
+#else
+        bool parallel = false;
+#endif
+#ifdef __DELIMITER_BRACKETS__
+        const bool listed_delimiters = true;
+#else
+        const bool listed_delimiters = false;
+#endif
+        while (!args.empty())
+        {
+            if (args[0] == "--source")
+            {
+                source = true;
+                args.erase(args.begin());
+            }
+            else if (args[0] == "--all")
+            {
+                all = true;
+                args.erase(args.begin());
+            }
+            else if (args[0] == "--parallel")
+            {
+                parallel = true;
+                args.erase(args.begin());
+            }
+            else if (args.size() >= 2 && args[0] == "--delimiters")
+            {
+                delimiters.reset(new DelimiterSet(args[1]));
+                args.erase(args.begin(), args.begin() + 2);
+            }
+            else
+            {
+                break;
+            }
+        }
+        if (!args.empty() && args[0] == "--batch")
+        {
+            if (all)
+            {
+                std::cerr << "Error: --all is not supported in batch mode."
+                          << std::endl;
+                usage();
+                return EXIT_FAILURE;
+            }
+            args.erase(args.begin());
+            return batch_main(args, delimiters.get(), source);
+        }
+#ifdef __BATCH_BRACKETS__
+        //The test file is a manifest checked in batch mode with 4 threads.
+        if (args.size() == 1)
         {
-            std::cerr << "Usage: check_brackets filename" << std::endl;
+            std::ifstream manifest (args[0]);
+            if (!manifest)
+            {
+                std::cerr << "Error: could not open input filename '" << args[0] << "'." << std::endl;
+                usage();
+                return EXIT_FAILURE;
+            }
+            const int code = batch_main(std::vector<std::string>{"-j", "4"},
+                                        delimiters.get(), source, manifest,
+                                        false);
+            std::cout << "Exit code: "
+                      << (code == EXIT_SUCCESS ? "EXIT_SUCCESS" : "EXIT_FAILURE")
+                      << std::endl;
+            return code;
+        }
+#endif
+        if (args.size() != 1)
+        {
+            usage();
             return EXIT_FAILURE;
         }
-        std::ifstream input (argv[1]);
+        std::ifstream input (args[0]);
         if (!input)
         {
-            std::cerr << "Error: could not open input filename '" << argv[1] << "'." << std::endl;
-            std::cerr << "Usage: check_brackets filename" << std::endl;
+            std::cerr << "Error: could not open input filename '" << args[0] << "'." << std::endl;
+            usage();
             return EXIT_FAILURE;
         }
-        size_t pos = check_brackets(input);
+        input.close();
+        size_t pos = 0;
+        if (all)
+        {
+            const DelimiterSet pairs = (delimiters == nullptr) ? DelimiterSet()
+                                                               : *delimiters;
+            const size_t n_errors = source
+                    ? report_all_errors(args[0], SourceDelimiters<DelimiterSet>(pairs))
+                    : report_all_errors(args[0], pairs);
+            if (n_errors == 0)
+                std::cout << "Success" << std::endl;
+            return EXIT_SUCCESS;
+        }
+        if (listed_delimiters)
+        {
+            pos = check_listed_delimiters(args[0]);
+        }
+        else if (parallel)
+        {
+            pos = check_all_chunkings(args[0]);
+        }
+        else if (source)
+        {
+            size_t bytes = 0;
+            const DelimiterSet pairs = (delimiters == nullptr) ? DelimiterSet()
+                                                               : *delimiters;
+            BasicBracketChecker< SourceDelimiters<DelimiterSet> > checker (
+                        (SourceDelimiters<DelimiterSet>(pairs)));
+            pos = checker.check_file(args[0], bytes);
+        }
+        else if (delimiters == nullptr)
+        {
+            pos = check_brackets_file(args[0]);
+        }
+        else
+        {
+            size_t bytes = 0;
+            BasicBracketChecker<DelimiterSet> checker (*delimiters);
+            pos = checker.check_file(args[0], bytes);
+        }
         if (pos==0)
             std::cout << "Success" << std::endl;
         else
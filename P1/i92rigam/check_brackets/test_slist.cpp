@@ -3,7 +3,13 @@
 #include <fstream>
 #include <string>
 
+#ifdef __POOLED_SLIST__
+#include "pooled_slist.hpp"
+typedef PooledSList<int> List;
+#else
 #include "slist.hpp"
+typedef SList<int> List;
+#endif
 
 int
 main(int argc, const char* argv[])
@@ -25,7 +31,7 @@ main(int argc, const char* argv[])
             return EXIT_FAILURE;
         }
 
-        auto l = SList<int>::create();
+        auto l = List::create();
 
         while(input)
         {
@@ -52,6 +58,21 @@ main(int argc, const char* argv[])
                     std::cout << "Inserting front " << v << std::endl;
                     l->push_front(v);
                 }
+                else if (operation == "PUSH_BACK")
+                {
+                    int v;
+                    input >> v;
+                    std::cout << "Inserting back " << v << std::endl;
+                    l->push_back(v);
+                }
+                else if (operation == "BACK")
+                {
+                    std::cout << "Back item: " << l->back() << std::endl;
+                }
+                else if (operation == "SIZE")
+                {
+                    std::cout << "Size: " << l->size() << std::endl;
+                }
                 else if (operation == "POP_FRONT")
                 {
                     std::cout << "Removing front " << l->current() << std::endl;
@@ -73,7 +94,7 @@ main(int argc, const char* argv[])
                 {                    
                     try
                     {
-                        l = SList<int>::create(input);
+                        l = List::create(input);
                     }
                     catch (std::runtime_error const& e)
                     {
@@ -4,6 +4,12 @@
 #include <string>
 #include "stack.hpp"
 
+#ifdef __ARRAY_STACK__
+typedef Stack< int, ArrayStackStorage<int> > TestStack;
+#else
+typedef Stack<int> TestStack;
+#endif
+
 int
 main(int argc, const char* argv[])
 {
@@ -24,7 +30,7 @@ main(int argc, const char* argv[])
             return EXIT_FAILURE;
         }
 
-        Stack<int> stack;
+        TestStack stack;
 
         while(input)
         {
@@ -0,0 +1,587 @@
+#include <algorithm>
+#include <chrono>
+#include <numeric>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <random>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "btree.hpp"
+#include "btree_utils.hpp"
+#include "compact_btree.hpp"
+#include "btree_image.hpp"
+
+#if defined(__GLIBC__) && (__GLIBC__ > 2 || __GLIBC_MINOR__ >= 33)
+#include <malloc.h>
+
+/** @brief Bytes in use by malloc, including its own headers.*/
+size_t
+heap_in_use()
+{
+    return mallinfo2().uordblks;
+}
+#else
+/** @brief The heap use is not known in this platform.*/
+size_t
+heap_in_use()
+{
+    return 0;
+}
+#endif
+
+/**
+ * @brief The recursive prefix processing walking subtrees.
+ * Each visit creates the left and right subtree wrappers.
+ */
+template <class T, typename Processor>
+bool
+recursive_prefix_process(typename BTree<T>::Ref tree, Processor& p)
+{
+    bool retVal = true;
+    if(!tree->is_empty())
+    {
+        retVal = retVal && p(tree->item());
+        retVal = retVal && recursive_prefix_process<T, Processor>(tree->left(), p);
+        retVal = retVal && recursive_prefix_process<T, Processor>(tree->right(), p);
+    }
+    return retVal;
+}
+
+/**
+ * @brief Build a balanced tree with the items [first, last).
+ * @return the root node.
+ */
+BTNode<int>::Ref
+build_balanced(int first, int last)
+{
+    BTNode<int>::Ref node;
+    if (first < last)
+    {
+        const int middle = first + (last - first) / 2;
+        node = BTNode<int>::create(middle, build_balanced(first, middle),
+                                   build_balanced(middle + 1, last));
+    }
+    return node;
+}
+
+/**
+ * @brief Build a skewed tree with the items [first, last).
+ * The root of each subtree leaves an eighth of the items on its left, so
+ * the left subtrees are much smaller than the right ones.
+ * @return the root node.
+ */
+BTNode<int>::Ref
+build_skewed(int first, int last)
+{
+    BTNode<int>::Ref node;
+    if (first < last)
+    {
+        const int middle = first + (last - first) / 8;
+        node = BTNode<int>::create(middle, build_skewed(first, middle),
+                                   build_skewed(middle + 1, last));
+    }
+    return node;
+}
+
+/**
+ * @brief Build a tree where each node only has a right child.
+ * @return the root node.
+ */
+BTNode<int>::Ref
+build_degenerate(int n)
+{
+    BTNode<int>::Ref root;
+    for (int i = n; i > 0; --i)
+    {
+        root = BTNode<int>::create(i - 1, nullptr, root);
+    }
+    return root;
+}
+
+/** @brief Make a tree whose root is a given node.*/
+BTree<int>::Ref
+make_tree(BTNode<int>::Ref root)
+{
+    auto tree = BTree<int>::create();
+    if (root != nullptr)
+    {
+        tree->create_root(root->item());
+        tree->root()->set_left(root->left());
+        tree->root()->set_right(root->right());
+    }
+    return tree;
+}
+
+/** @brief A processor adding the items.*/
+struct Sum
+{
+    long long sum;
+
+    bool operator()(int v)
+    {
+        sum += v;
+        return true;
+    }
+};
+
+/**
+ * @brief Time a traversal and print its ns per node.
+ * @param name is the label printed.
+ * @param n is the number of nodes.
+ * @param traversal runs the traversal with a Sum processor.
+ */
+template <class Traversal>
+void
+run(std::string const& name, size_t n, Traversal traversal)
+{
+    Sum p {0};
+    auto start = std::chrono::steady_clock::now();
+    traversal(p);
+    auto stop = std::chrono::steady_clock::now();
+    std::cout << name << "\t"
+              << std::chrono::duration<double, std::nano>(stop - start).count() / n
+              << " ns/node\t(sum " << p.sum << ")" << std::endl;
+}
+
+/**
+ * @brief Search keys descending from the root of a search tree.
+ * @param keys are the keys searched.
+ * @param find returns true if a key is found.
+ */
+template <class Find>
+void
+run_search(std::string const& name, std::vector<int> const& keys, Find find)
+{
+    size_t found = 0;
+    auto start = std::chrono::steady_clock::now();
+    for (int key : keys)
+        found += find(key);
+    auto stop = std::chrono::steady_clock::now();
+    std::cout << name << "\t"
+              << std::chrono::duration<double, std::nano>(stop - start).count() / keys.size()
+              << " ns/search\t(found " << found << ")" << std::endl;
+}
+
+/**
+ * @brief Compare the shared_ptr nodes with the compact layouts over a
+ * balanced search tree with the keys 0, ..., n-1.
+ */
+void
+run_compact(size_t n)
+{
+    const size_t before = heap_in_use();
+    auto tree = make_tree(build_balanced(0, int(n)));
+    const size_t tree_bytes = heap_in_use() - before;
+    auto preorder = CompactBTree<int>::create(tree, CompactLayout::PREORDER);
+    auto veb = CompactBTree<int>::create(tree, CompactLayout::VAN_EMDE_BOAS);
+    std::cout << "Memory per node: BTNode " << double(tree_bytes) / n
+              << " bytes, compact " << double(preorder->memory()) / n
+              << " bytes." << std::endl;
+
+    run("BTree prefix    ", n, [&](Sum& p) { prefix_process<int>(tree, p); });
+    run("preorder prefix ", n, [&](Sum& p) { prefix_process<int>(*preorder, p); });
+    run("vEB prefix      ", n, [&](Sum& p) { prefix_process<int>(*veb, p); });
+    run("BTree infix     ", n, [&](Sum& p) { infix_process<int>(tree, p); });
+    run("preorder infix  ", n, [&](Sum& p) { infix_process<int>(*preorder, p); });
+    run("vEB infix       ", n, [&](Sum& p) { infix_process<int>(*veb, p); });
+    run("BTree breadth   ", n, [&](Sum& p) { breadth_first_process<int>(tree, p); });
+    run("preorder breadth", n, [&](Sum& p) { breadth_first_process<int>(*preorder, p); });
+    run("vEB breadth     ", n, [&](Sum& p) { breadth_first_process<int>(*veb, p); });
+
+    std::vector<int> keys (1000000);
+    std::mt19937 gen (1);
+    for (int& key : keys)
+        key = int(gen() % (2 * n));
+    run_search("BTree search    ", keys, [&](int key)
+    {
+        BTNode<int> const* node = tree->root().get();
+        while (node != nullptr && node->item() != key)
+            node = (key < node->item() ? node->left() : node->right()).get();
+        return node != nullptr;
+    });
+    for (auto compact : {preorder, veb})
+    {
+        run_search(compact == veb ? "vEB search      " : "preorder search ",
+                   keys, [&](int key)
+        {
+            CompactBTree<int>::Index i = compact->root();
+            while (i != CompactBTree<int>::NIL && compact->item(i) != key)
+                i = key < compact->item(i) ? compact->left(i) : compact->right(i);
+            return i != CompactBTree<int>::NIL;
+        });
+    }
+    auto start = std::chrono::steady_clock::now();
+    auto copy = veb->to_btree();
+    auto stop = std::chrono::steady_clock::now();
+    std::cout << "vEB to BTree    \t"
+              << std::chrono::duration<double, std::nano>(stop - start).count() / n
+              << " ns/node" << std::endl;
+}
+
+/**
+ * @brief Time a step and print its ns per node.
+ * @param step runs the step.
+ */
+template <class Step>
+void
+run_step(std::string const& name, size_t n, Step step)
+{
+    auto start = std::chrono::steady_clock::now();
+    step();
+    auto stop = std::chrono::steady_clock::now();
+    std::cout << name << "\t"
+              << std::chrono::duration<double, std::nano>(stop - start).count() / n
+              << " ns/node" << std::endl;
+}
+
+/**
+ * @brief Fold a tree and unfold it back from a stream, a buffer and a file.
+ * @return true if all the copies fold as the tree.
+ */
+bool
+run_fold(BTree<int>::Ref tree, size_t n)
+{
+    std::ostringstream out;
+    run_step("fold stream     ", n, [&]() { tree->fold(out); });
+    std::string folded;
+    run_step("fold string     ", n, [&]() { tree->fold(folded); });
+    std::cout << "Folded size     \t" << double(folded.size()) / n
+              << " bytes/node" << std::endl;
+
+    BTree<int>::Ref from_stream;
+    run_step("unfold stream   ", n, [&]()
+    {
+        std::istringstream in (folded);
+        from_stream = BTree<int>::create(in);
+    });
+    BTree<int>::Ref from_buffer;
+    run_step("unfold buffer   ", n, [&]()
+    {
+        from_buffer = BTree<int>::create(folded.data(), folded.size());
+    });
+    const std::string filename = "bench_btree.tmp";
+    {
+        std::ofstream file (filename, std::ios::binary);
+        file << folded;
+    }
+    BTree<int>::Ref from_file;
+    run_step("load file       ", n, [&]()
+    {
+        from_file = BTree<int>::load(filename);
+    });
+
+    //The binary image of the tree, loaded in place.
+    const std::string image_filename = "bench_btree.img";
+    run_step("save image      ", n, [&]()
+    {
+        std::ofstream file (image_filename, std::ios::binary);
+        BTreeImage<int>::save(tree, file);
+    });
+    BTreeImage<int>::Ref image;
+    run_step("load image      ", n, [&]()
+    {
+        image = BTreeImage<int>::load(image_filename);
+    });
+    const size_t image_bytes = size_t(
+                std::ifstream(image_filename, std::ios::binary | std::ios::ate).tellg());
+    std::cout << "Image size      \t" << double(image_bytes) / n
+              << " bytes/node" << std::endl;
+    run("image prefix    ", n, [&](Sum& p) { prefix_process<int>(*image, p); });
+    run("image infix     ", n, [&](Sum& p) { infix_process<int>(*image, p); });
+    BTree<int>::Ref from_image;
+    run_step("image to BTree  ", n, [&]() { from_image = image->to_btree(); });
+    std::remove(filename.c_str());
+    std::remove(image_filename.c_str());
+
+    bool same = out.str() == folded;
+    for (auto copy : {from_stream, from_buffer, from_file, from_image})
+    {
+        std::string copy_folded;
+        same = same && copy->fold(copy_folded) == folded;
+    }
+    return same;
+}
+
+/**
+ * @brief Insert random keys in order and print the cost of each batch.
+ * The insertions keep their O(height) cost in the debug builds unless
+ * __BTREE_ORDER_CHECK__ asks for whole tree checks.
+ * @param n is the number of keys.
+ * @param full_check is true to also check the whole tree after each insertion.
+ */
+void
+run_insert(size_t n, bool full_check)
+{
+    auto tree = BTree<int>::create();
+    std::mt19937 gen (1);
+    size_t inserted = 0;
+    for (size_t batch = 1000; inserted < n; batch *= 10)
+    {
+        const size_t count = std::min(batch, n) - inserted;
+        auto start = std::chrono::steady_clock::now();
+        for (size_t i = 0; i < count; ++i)
+        {
+            insert_in_order<int>(tree, int(gen()));
+            if (full_check && !check_btree_in_order<int>(tree))
+                std::cerr << "Error: tree not in order." << std::endl;
+        }
+        auto stop = std::chrono::steady_clock::now();
+        inserted += count;
+        std::cout << "up to " << inserted << " keys\t"
+                  << std::chrono::duration<double, std::nano>(stop - start).count() / count
+                  << " ns/insert" << std::endl;
+    }
+}
+
+/**
+ * @brief Build a search tree by repeated insertion and in bulk.
+ * @param keys are the keys, in the order inserted.
+ * @param n_threads is the number of threads of the parallel bulk build.
+ */
+void
+run_build(std::vector<int> const& keys, unsigned n_threads)
+{
+    const size_t n = keys.size();
+    // The first allocations after freeing a large tree pay for the allocator
+    // tidying its free lists, so an untimed build takes that cost.
+    build_balanced_bst<int>(keys.begin(), keys.end());
+    BTree<int>::Ref built;
+    run_step("bulk 1 thread   ", n, [&]()
+    {
+        built = build_balanced_bst<int>(keys.begin(), keys.end());
+    });
+    BTree<int>::Ref parallel;
+    run_step("bulk " + std::to_string(n_threads) + " threads  ", n, [&]()
+    {
+        parallel = build_balanced_bst<int>(keys.begin(), keys.end(), n_threads);
+    });
+    BTree<int>::Ref inserted = BTree<int>::create();
+    run_step("insert_in_order ", n, [&]()
+    {
+        for (int key : keys)
+            insert_in_order<int>(inserted, key);
+    });
+    std::cout << "Heights: bulk " << compute_height<int>(built)
+              << ", parallel " << compute_height<int>(parallel)
+              << ", insert_in_order " << compute_height<int>(inserted) << std::endl;
+}
+
+/**
+ * @brief Compare a search tree with plain nodes and one whose nodes keep
+ * their subtree size and height.
+ * @param keys are the keys, in the order inserted.
+ */
+void
+run_sized(std::vector<int> const& keys)
+{
+    const size_t n = keys.size();
+    auto plain = BTree<int>::create();
+    run_step("insert plain    ", n, [&]()
+    {
+        for (int key : keys)
+            insert_in_order<int>(plain, key);
+    });
+    auto sized = BTree<int, BTSizeHeightAugment>::create();
+    run_step("insert sized    ", n, [&]()
+    {
+        for (int key : keys)
+            insert_in_order<int>(sized, key);
+    });
+    size_t size = 0;
+    int height = 0;
+    run_step("walk size+height", n, [&]()
+    {
+        size = compute_size<int>(plain);
+        height = compute_height<int>(plain);
+    });
+    auto start = std::chrono::steady_clock::now();
+    const size_t sized_size = compute_size<int>(sized);
+    const int sized_height = compute_height<int>(sized);
+    auto stop = std::chrono::steady_clock::now();
+    std::cout << "sized size+height\t"
+              << std::chrono::duration<double, std::nano>(stop - start).count()
+              << " ns\t(size " << sized_size << ", height " << sized_height
+              << ")" << std::endl;
+    if (size != sized_size || height != sized_height)
+        std::cerr << "Error: the cached size or height differ." << std::endl;
+    size_t ranks = 0;
+    run_step("rank_in_order   ", n, [&]()
+    {
+        for (int key : keys)
+            ranks += rank_in_order<int>(sized, key);
+    });
+    long long sum = 0;
+    run_step("select_in_order ", n, [&]()
+    {
+        for (size_t k = 0; k < n; ++k)
+            sum += select_in_order<int>(sized, (k * 7919) % sized_size);
+    });
+    std::cout << "(ranks " << ranks << ", sum " << sum << ")" << std::endl;
+}
+
+/**
+ * @brief Time the sequential and the parallel size and height computations
+ * with 1, 2, 4 ... max_threads threads.
+ */
+void
+run_reduce(BTree<int>::Ref tree, size_t n, unsigned max_threads)
+{
+    size_t size = 0;
+    int height = 0;
+    run_step("size+height     ", n, [&]()
+    {
+        size = compute_size<int>(tree);
+        height = compute_height<int>(tree);
+    });
+    for (unsigned n_threads = 1; n_threads <= max_threads; n_threads *= 2)
+    {
+        size_t parallel_size = 0;
+        int parallel_height = 0;
+        run_step("parallel " + std::to_string(n_threads) + " threads", n, [&]()
+        {
+            parallel_size = parallel_compute_size<int>(tree, n_threads);
+            parallel_height = parallel_compute_height<int>(tree, n_threads);
+        });
+        if (parallel_size != size || parallel_height != height)
+            std::cerr << "Error: the parallel size or height differ." << std::endl;
+    }
+    long long sum = 0;
+    run_step("parallel sum    ", n, [&]()
+    {
+        sum = parallel_reduce<int>(tree, 0LL, [](int v) { return (long long)v; },
+                                   [](long long item, long long left, long long right)
+                                   {
+                                       return item + left + right;
+                                   },
+                                   max_threads);
+    });
+    std::cout << "(size " << size << ", height " << height << ", sum " << sum
+              << ")" << std::endl;
+}
+
+/**
+ * @brief Run the traversals over a tree.
+ * @param recursive is true to also run the recursive prefix processing.
+ */
+void
+run_all(BTree<int>::Ref tree, size_t n, bool recursive)
+{
+    if (recursive)
+    {
+        run("recursive prefix", n, [&](Sum& p)
+        {
+            recursive_prefix_process<int>(tree, p);
+        });
+    }
+    run("prefix          ", n, [&](Sum& p) { prefix_process<int>(tree, p); });
+    run("infix           ", n, [&](Sum& p) { infix_process<int>(tree, p); });
+    run("postfix         ", n, [&](Sum& p) { postfix_process<int>(tree, p); });
+    run("breadth first   ", n, [&](Sum& p) { breadth_first_process<int>(tree, p); });
+    BTNodeRing<int> queue;
+    run("breadth reused q", n, [&](Sum& p) { breadth_first_process<int>(tree, p, queue); });
+    run("breadth iterator", n, [&](Sum& p)
+    {
+        for (int v : tree->breadth_first())
+            p(v);
+    });
+    size_t width = 0;
+    run("levels (width)  ", n, [&](Sum& p)
+    {
+        auto level = [&](size_t, BTNodeRing<int> const& nodes)
+        {
+            width = std::max(width, nodes.size());
+            for (size_t i = 0; i < nodes.size(); ++i)
+                p(nodes[i]->item());
+            return true;
+        };
+        level_by_level_process<int>(tree, level, queue);
+    });
+    run("infix range-for ", n, [&](Sum& p)
+    {
+        for (int v : *tree)
+            p(v);
+    });
+    run("accumulate      ", n, [&](Sum& p)
+    {
+        auto items = tree->postfix();
+        p.sum = std::accumulate(items.begin(), items.end(), 0LL);
+    });
+    auto start = std::chrono::steady_clock::now();
+    const size_t size = compute_size<int>(tree);
+    const int height = compute_height<int>(tree);
+    auto stop = std::chrono::steady_clock::now();
+    std::cout << "size+height     \t"
+              << std::chrono::duration<double, std::nano>(stop - start).count() / n
+              << " ns/node\t(size " << size << ", height " << height << ")"
+              << std::endl;
+}
+
+int
+main(int argc, const char* argv[])
+{
+    size_t n = 10000000;
+    if (argc > 1)
+        n = std::strtoul(argv[1], nullptr, 10);
+    if (argc > 2 || n == 0)
+    {
+        std::cerr << "Usage: bench_btree [n_nodes]" << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    //The recursive processing is only run over the balanced tree, a
+    //degenerate one would overflow the stack.
+    std::cout << "Balanced tree, " << n << " nodes:" << std::endl;
+    run_all(make_tree(build_balanced(0, int(n))), n, true);
+    std::cout << "Degenerate tree, " << n << " nodes:" << std::endl;
+    run_all(make_tree(build_degenerate(int(n))), n, false);
+    std::cout << "Compact balanced tree, " << n << " nodes:" << std::endl;
+    run_compact(n);
+
+    std::cout << "Insert in order (__BTREE_ORDER_CHECK__ "
+              << __BTREE_ORDER_CHECK__ << "):" << std::endl;
+    run_insert(n, false);
+    std::cout << "Insert in order checking the whole tree each time:" << std::endl;
+    run_insert(std::min<size_t>(n, 10000), true);
+
+    const unsigned n_threads = std::max(4u, std::thread::hardware_concurrency());
+    std::vector<int> keys (n);
+    std::mt19937 gen (2);
+    for (int& key : keys)
+        key = int(gen());
+    std::cout << "Search tree of " << n << " random keys:" << std::endl;
+    run_build(keys, n_threads);
+    //Repeated insertion of sorted keys builds a list, so they are less.
+    keys.resize(std::min<size_t>(n, 10000));
+    std::sort(keys.begin(), keys.end());
+    std::cout << "Search tree of " << keys.size() << " sorted keys:" << std::endl;
+    run_build(keys, n_threads);
+
+    keys.resize(n);
+    for (int& key : keys)
+        key = int(gen());
+    std::cout << "Sized search tree of " << n << " random keys:" << std::endl;
+    run_sized(keys);
+
+    std::cout << "Reduce balanced tree, " << n << " nodes:" << std::endl;
+    run_reduce(make_tree(build_balanced(0, int(n))), n, n_threads);
+    std::cout << "Reduce skewed tree, " << n << " nodes:" << std::endl;
+    run_reduce(make_tree(build_skewed(0, int(n))), n, n_threads);
+    std::cout << "Reduce degenerate tree, " << n << " nodes:" << std::endl;
+    run_reduce(make_tree(build_degenerate(int(n))), n, n_threads);
+
+    std::cout << "Fold balanced tree, " << n << " nodes:" << std::endl;
+    bool same = run_fold(make_tree(build_balanced(0, int(n))), n);
+    std::cout << "Fold degenerate tree, " << n << " nodes:" << std::endl;
+    same = run_fold(make_tree(build_degenerate(int(n))), n) && same;
+    if (!same)
+    {
+        std::cerr << "Error: the unfolded trees differ." << std::endl;
+        return EXIT_FAILURE;
+    }
+    return EXIT_SUCCESS;
+}
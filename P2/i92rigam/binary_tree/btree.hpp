@@ -2,14 +2,103 @@
 #define __ED_BTree_HPP__
 
 #include <cassert>
+#include <cstddef>
 #include <exception>
+#include <fstream>
+#include <iterator>
+#include <limits>
+#include <locale>
 #include <memory>
 #include <iostream>
 #include <sstream>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
 
-/** @brief a BTree's Node.*/
-template <class T>
-class BTNode
+/**
+ * @brief Augment policy of a BTNode that keeps nothing, the default one.
+ *
+ * An augment policy is a base class of BTNode keeping data computed from the
+ * node's item and children. The node calls update(*this) each time its item
+ * or children change, so its data is right when the ones of its children
+ * are. The ancestors of a changed node must be updated from the bottom up
+ * calling BTNode::update_augment(), as insert_in_order does when updates
+ * is true.
+ */
+struct BTNoAugment
+{
+    /** @brief Must the ancestors of a changed node be updated?*/
+    static constexpr bool updates = false;
+
+    template <class Node>
+    void update(Node const&)
+    {}
+};
+
+/** @brief Augment policy of a BTNode keeping the size and height of its
+ * subtree, so they are got in O(1).*/
+class BTSizeHeightAugment
+{
+public:
+
+    static constexpr bool updates = true;
+
+    BTSizeHeightAugment()
+        : size_(1), height_(0)
+    {}
+
+    /** @brief Get the number of nodes of the subtree rooted at the node.*/
+    size_t size() const
+    {
+        return size_;
+    }
+
+    /** @brief Get the height of the subtree rooted at the node.*/
+    int height() const
+    {
+        return height_;
+    }
+
+    template <class Node>
+    void update(Node const& node)
+    {
+        size_ = 1;
+        height_ = 0;
+        if (node.has_left())
+        {
+            size_ += node.left()->size();
+            height_ = node.left()->height() + 1;
+        }
+        if (node.has_right())
+        {
+            size_ += node.right()->size();
+            if (node.right()->height() >= height_)
+                height_ = node.right()->height() + 1;
+        }
+    }
+
+protected:
+
+    size_t size_;
+    int height_;
+};
+
+/**
+ * @brief a BTree's Node.
+ * Augment is the augment policy, BTNoAugment by default.
+ * @see BTNoAugment
+ */
+template <class T, class Augment = BTNoAugment>
+class BTNode : public Augment
 {
 public:
 
@@ -18,7 +107,7 @@ public:
      * facility, possibly sharing that management with other objects.
      * @see http://www.cplusplus.com/reference/memory/shared_ptr/
      */
-    typedef std::shared_ptr< BTNode<T> > Ref;
+    typedef std::shared_ptr< BTNode<T, Augment> > Ref;
 
     /** @name Life cicle.*/
     /** @{*/
@@ -26,11 +115,12 @@ public:
     /** @brief Create a BTNode.
      * @post n_children() == 0
      */
-    BTNode (T const& it=T(), BTNode<T>::Ref left=nullptr, BTNode<T>::Ref right=nullptr)
+    BTNode (T const& it=T(), BTNode<T, Augment>::Ref left=nullptr, BTNode<T, Augment>::Ref right=nullptr)
     {
         item_ = it;
-        leftNode_ = left;
-        rightNode_ = right;
+        leftNode_ = std::move(left);
+        rightNode_ = std::move(right);
+        update_augment();
     }
 
     /**
@@ -40,14 +130,33 @@ public:
      * @param right links to the right child.
      * @return a shared referente to the new node.
      */
-    static typename BTNode<T>::Ref create(T const& it, BTNode<T>::Ref left=nullptr, BTNode<T>::Ref right=nullptr)
+    static typename BTNode<T, Augment>::Ref create(T const& it, BTNode<T, Augment>::Ref left=nullptr, BTNode<T, Augment>::Ref right=nullptr)
     {
-        return std::make_shared<BTNode<T>> (it, left, right);
+        return std::make_shared<BTNode<T, Augment>> (it, std::move(left), std::move(right));
     }
 
-    /** @brief Destroy a BTNode. **/
+    /** @brief Destroy a BTNode.
+     * The descendants only linked from this node are released one by one
+     * instead of recursively, so a deep tree does not overflow the stack.
+     **/
     ~BTNode()
-    {}
+    {
+        if (leftNode_.use_count() != 1 && rightNode_.use_count() != 1)
+            return;
+        std::vector<typename BTNode<T, Augment>::Ref> pending;
+        pending.push_back(std::move(leftNode_));
+        pending.push_back(std::move(rightNode_));
+        while (!pending.empty())
+        {
+            typename BTNode<T, Augment>::Ref node = std::move(pending.back());
+            pending.pop_back();
+            if (node != nullptr && node.use_count() == 1)
+            {
+                pending.push_back(std::move(node->leftNode_));
+                pending.push_back(std::move(node->rightNode_));
+            }
+        }
+    }
 
     /** @}*/
 
@@ -67,7 +176,7 @@ public:
     }
 
     /** @brief get the left child.*/
-    BTNode<T>::Ref left() const
+    typename BTNode<T, Augment>::Ref const& left() const
     {
         return leftNode_;
     }
@@ -79,7 +188,7 @@ public:
     }
 
     /** @brief get the right child.*/
-    BTNode<T>::Ref right() const
+    typename BTNode<T, Augment>::Ref const& right() const
     {
         return rightNode_;
     }
@@ -92,45 +201,533 @@ public:
     void set_item(const T& new_it)
     {
         item_ = new_it;
+        update_augment();
     }
 
     /** @brief Set the left child.*/
-    void set_left(BTNode<T>::Ref new_child)
+    void set_left(BTNode<T, Augment>::Ref new_child)
     {
-        leftNode_ = new_child;
+        leftNode_ = std::move(new_child);
+        update_augment();
     }
 
     /** @brief Remove link to the left child. */
     void remove_left()
     {
         leftNode_ = nullptr;
+        update_augment();
     }
 
     /** @brief Set the right child.*/
-    void set_right(BTNode<T>::Ref new_child)
+    void set_right(BTNode<T, Augment>::Ref new_child)
     {
-        rightNode_ = new_child;
+        rightNode_ = std::move(new_child);
+        update_augment();
     }
 
     /** @brief Remove linkt to the right child. */
     void remove_right()
     {
         rightNode_ = nullptr;
+        update_augment();
+    }
+
+    /** @brief Recompute the augment data from the item and the children.*/
+    void update_augment()
+    {
+        Augment::update(*this);
     }
 
 protected:
 
     T item_;
-    typename BTNode<T>::Ref rightNode_;
-    typename BTNode<T>::Ref leftNode_;
+    typename BTNode<T, Augment>::Ref rightNode_;
+    typename BTNode<T, Augment>::Ref leftNode_;
+
+};
+
+/**
+ * @brief Common part of the BTree iterators.
+ *
+ * The iterators walk the BTNode links directly and keep the nodes waiting
+ * to be visited in a vector that is reused while iterating, so advancing
+ * does not allocate subtrees. The end iterator has no node.
+ */
+template <class T, class Node = BTNode<T> >
+class BTreeIteratorBase
+{
+public:
+
+    typedef std::forward_iterator_tag iterator_category;
+    typedef T value_type;
+    typedef std::ptrdiff_t difference_type;
+    typedef T const* pointer;
+    typedef T const& reference;
+    typedef Node node_type;
+
+    /** @brief Get the item of the node visited.
+     * @pre it is not the end iterator.
+     */
+    T const& operator*() const
+    {
+        assert(node_ != nullptr);
+        return node_->item();
+    }
+
+    T const* operator->() const
+    {
+        assert(node_ != nullptr);
+        return &node_->item();
+    }
+
+    /** @brief Get the node visited, nullptr at the end.*/
+    Node const* node() const
+    {
+        return node_;
+    }
+
+    bool operator==(BTreeIteratorBase<T, Node> const& other) const
+    {
+        return node_ == other.node_;
+    }
+
+    bool operator!=(BTreeIteratorBase<T, Node> const& other) const
+    {
+        return node_ != other.node_;
+    }
+
+protected:
+
+    BTreeIteratorBase()
+        : node_(nullptr)
+    {}
+
+    /** @brief Take the last pending node, or nullptr if there is none.*/
+    Node const* pop()
+    {
+        Node const* node = nullptr;
+        if (!pending_.empty())
+        {
+            node = pending_.back();
+            pending_.pop_back();
+        }
+        return node;
+    }
+
+    Node const* node_;
+    std::vector<Node const*> pending_;
+};
+
+/** @brief Iterator visiting a tree in prefix order.*/
+template <class T, class Node = BTNode<T> >
+class BTreePrefixIterator : public BTreeIteratorBase<T, Node>
+{
+public:
+
+    /** @brief Create an iterator from a root node, nullptr for the end.*/
+    explicit BTreePrefixIterator(Node const* root = nullptr)
+    {
+        this->node_ = root;
+    }
+
+    BTreePrefixIterator& operator++()
+    {
+        assert(this->node_ != nullptr);
+        if (this->node_->has_right())
+        {
+            this->pending_.push_back(this->node_->right().get());
+        }
+        if (this->node_->has_left())
+        {
+            this->node_ = this->node_->left().get();
+        }
+        else
+        {
+            this->node_ = this->pop();
+        }
+        return *this;
+    }
+
+    BTreePrefixIterator operator++(int)
+    {
+        BTreePrefixIterator old = *this;
+        ++*this;
+        return old;
+    }
+};
+
+/** @brief Iterator visiting a tree in infix order.*/
+template <class T, class Node = BTNode<T> >
+class BTreeInfixIterator : public BTreeIteratorBase<T, Node>
+{
+public:
+
+    /** @brief Create an iterator from a root node, nullptr for the end.*/
+    explicit BTreeInfixIterator(Node const* root = nullptr)
+    {
+        descend(root);
+    }
+
+    BTreeInfixIterator& operator++()
+    {
+        assert(this->node_ != nullptr);
+        descend(this->node_->right().get());
+        return *this;
+    }
+
+    BTreeInfixIterator operator++(int)
+    {
+        BTreeInfixIterator old = *this;
+        ++*this;
+        return old;
+    }
+
+protected:
+
+    /** @brief Go to the leftmost node of a subtree, or to the next ancestor
+     * if the subtree is empty. */
+    void descend(Node const* node)
+    {
+        while (node != nullptr)
+        {
+            this->pending_.push_back(node);
+            node = node->left().get();
+        }
+        this->node_ = this->pop();
+    }
+};
+
+/** @brief Iterator visiting a tree in postfix order.*/
+template <class T, class Node = BTNode<T> >
+class BTreePostfixIterator : public BTreeIteratorBase<T, Node>
+{
+public:
+
+    /** @brief Create an iterator from a root node, nullptr for the end.*/
+    explicit BTreePostfixIterator(Node const* root = nullptr)
+    {
+        descend(root);
+    }
+
+    BTreePostfixIterator& operator++()
+    {
+        assert(this->node_ != nullptr);
+        if (this->pending_.empty())
+        {
+            this->node_ = nullptr;
+        }
+        else
+        {
+            Node const* parent = this->pending_.back();
+            if (parent->left().get() == this->node_ && parent->has_right())
+            {
+                descend(parent->right().get());
+            }
+            else
+            {
+                this->node_ = this->pop();
+            }
+        }
+        return *this;
+    }
+
+    BTreePostfixIterator operator++(int)
+    {
+        BTreePostfixIterator old = *this;
+        ++*this;
+        return old;
+    }
+
+protected:
+
+    /** @brief Go to the first node of a subtree in postfix order.
+     * The pending nodes are the ancestors not visited yet. */
+    void descend(Node const* node)
+    {
+        while (node != nullptr)
+        {
+            this->pending_.push_back(node);
+            node = node->has_left() ? node->left().get() : node->right().get();
+        }
+        this->node_ = this->pop();
+    }
+};
+
+/** @brief Iterator visiting a tree in breadth first order.*/
+template <class T, class Node = BTNode<T> >
+class BTreeBreadthFirstIterator : public BTreeIteratorBase<T, Node>
+{
+public:
+
+    /** @brief Create an iterator from a root node, nullptr for the end.*/
+    explicit BTreeBreadthFirstIterator(Node const* root = nullptr)
+        : head_(0)
+    {
+        this->node_ = root;
+    }
+
+    BTreeBreadthFirstIterator& operator++()
+    {
+        assert(this->node_ != nullptr);
+        if (this->node_->has_left())
+        {
+            this->pending_.push_back(this->node_->left().get());
+        }
+        if (this->node_->has_right())
+        {
+            this->pending_.push_back(this->node_->right().get());
+        }
+        if (head_ < this->pending_.size())
+        {
+            this->node_ = this->pending_[head_++];
+            //Drop the visited nodes when they are the most of the vector.
+            if (head_ >= 64 && 2 * head_ >= this->pending_.size())
+            {
+                this->pending_.erase(this->pending_.begin(),
+                                     this->pending_.begin() + head_);
+                head_ = 0;
+            }
+        }
+        else
+        {
+            this->node_ = nullptr;
+        }
+        return *this;
+    }
+
+    BTreeBreadthFirstIterator operator++(int)
+    {
+        BTreeBreadthFirstIterator old = *this;
+        ++*this;
+        return old;
+    }
+
+protected:
+
+    /** @brief Index of the first pending node into the vector.*/
+    size_t head_;
+};
+
+/**
+ * @brief A tree seen as a range of items in a given order.
+ * The Iterator is one of the BTree iterators.
+ */
+template <class Iterator>
+class BTreeRange
+{
+public:
+
+    explicit BTreeRange(typename Iterator::node_type const* root)
+        : root_(root)
+    {}
+
+    Iterator begin() const
+    {
+        return Iterator(root_);
+    }
+
+    Iterator end() const
+    {
+        return Iterator();
+    }
+
+protected:
+
+    typename Iterator::node_type const* root_;
+};
+
+/**
+ * @brief Conversion of the items from and to the fold format.
+ *
+ * The generic version uses the item's stream operators through a reused
+ * string stream. Signed integers are converted by hand, giving the same
+ * result as the stream operators with the default format.
+ */
+template <class T, class Enable = void>
+struct BTreeItemFormat
+{
+    /** @brief Is format() the same as operator<< with the default format?*/
+    static constexpr bool by_hand = false;
+
+    /** @brief Parse the token [first, last) as istream::operator>> does.*/
+    static void parse(const char* first, const char* last, T& item,
+                      std::istringstream& in)
+    {
+        in.clear();
+        in.str(std::string(first, last));
+        in >> item;
+    }
+
+    /** @brief Append the item to buffer writing it with out.*/
+    static void format(T const& item, std::string& buffer,
+                       std::ostringstream& out)
+    {
+        out.str(std::string());
+        out << item;
+        buffer += out.str();
+    }
+};
+
+template <class T>
+struct BTreeItemFormat<T, typename std::enable_if<std::is_integral<T>::value
+                                                  && std::is_signed<T>::value
+                                                  && (sizeof(T) > 1)>::type>
+{
+    static constexpr bool by_hand = true;
+
+    /**
+     * @brief Parse the token [first, last) as istream::operator>> does.
+     * The leading digits are read, the item is 0 if there are none and it
+     * is clamped to the range of T if it overflows.
+     */
+    static void parse(const char* first, const char* last, T& item,
+                      std::istringstream&)
+    {
+        typedef typename std::make_unsigned<T>::type U;
+        const bool negative = first != last && *first == '-';
+        if (first != last && (*first == '-' || *first == '+'))
+            ++first;
+        const U limit = U(std::numeric_limits<T>::max()) + (negative ? 1 : 0);
+        U value = 0;
+        bool overflow = false;
+        for (; first != last && *first >= '0' && *first <= '9'; ++first)
+        {
+            const U digit = U(*first - '0');
+            if (overflow || value > (limit - digit) / 10)
+                overflow = true;
+            else
+                value = value * 10 + digit;
+        }
+        if (overflow)
+            item = negative ? std::numeric_limits<T>::min()
+                            : std::numeric_limits<T>::max();
+        else if (negative && value != 0)
+            item = T(-T(value - 1) - 1);
+        else
+            item = T(value);
+    }
 
+    /** @brief Append the item in decimal to buffer.*/
+    static void format(T const& item, std::string& buffer, std::ostringstream&)
+    {
+        typedef typename std::make_unsigned<T>::type U;
+        char digits[std::numeric_limits<U>::digits10 + 2];
+        char* p = digits + sizeof(digits);
+        U value = item < 0 ? U(0) - U(item) : U(item);
+        do
+        {
+            *--p = char('0' + value % 10);
+            value /= 10;
+        }
+        while (value != 0);
+        if (item < 0)
+            *--p = '-';
+        buffer.append(p, digits + sizeof(digits));
+    }
+};
+
+template <class T>
+constexpr bool BTreeItemFormat<T, typename std::enable_if<std::is_integral<T>::value
+                                                          && std::is_signed<T>::value
+                                                          && (sizeof(T) > 1)>::type>::by_hand;
+
+/**
+ * @brief Splits an input stream into whitespace separated tokens.
+ *
+ * The characters are taken from the stream buffer one by one, leaving the
+ * stream just after the last token and with the same state flags that
+ * operator>>(std::string&) would set.
+ */
+class BTreeStreamTokenizer
+{
+public:
+
+    explicit BTreeStreamTokenizer(std::istream& in)
+        : in_(in)
+    {}
+
+    /**
+     * @brief Read the next token.
+     * @param[out] first,
+     * @param[out] last specify the token, valid until the next call.
+     * @return false if there was no token.
+     */
+    bool next(const char*& first, const char*& last)
+    {
+        token_.clear();
+        if (!in_.good())
+        {
+            in_.setstate(std::ios_base::failbit);
+            return false;
+        }
+        std::streambuf* buf = in_.rdbuf();
+        typedef std::char_traits<char> traits;
+        traits::int_type c = buf->sgetc();
+        while (c != traits::eof() && is_space(traits::to_char_type(c)))
+            c = buf->snextc();
+        while (c != traits::eof() && !is_space(traits::to_char_type(c)))
+        {
+            token_.push_back(traits::to_char_type(c));
+            c = buf->snextc();
+        }
+        if (c == traits::eof())
+            in_.setstate(token_.empty() ? std::ios_base::eofbit | std::ios_base::failbit
+                                        : std::ios_base::eofbit);
+        first = token_.data();
+        last = first + token_.size();
+        return !token_.empty();
+    }
+
+    /** @brief Is c a whitespace of the "C" locale?*/
+    static bool is_space(char c)
+    {
+        return c == ' ' || (c >= '\t' && c <= '\r');
+    }
+
+protected:
+
+    std::istream& in_;
+    std::string token_;
+};
+
+/** @brief Splits a memory buffer into whitespace separated tokens.*/
+class BTreeBufferTokenizer
+{
+public:
+
+    /**
+     * @brief Create a tokenizer.
+     * @param data,
+     * @param size specify the buffer, it must outlive the tokenizer.
+     */
+    BTreeBufferTokenizer(const char* data, size_t size)
+        : p_(data), end_(data + size)
+    {}
+
+    /** @see BTreeStreamTokenizer::next*/
+    bool next(const char*& first, const char*& last)
+    {
+        while (p_ != end_ && BTreeStreamTokenizer::is_space(*p_))
+            ++p_;
+        first = p_;
+        while (p_ != end_ && !BTreeStreamTokenizer::is_space(*p_))
+            ++p_;
+        last = p_;
+        return first != last;
+    }
+
+protected:
+
+    const char* p_;
+    const char* end_;
 };
 
 /**
  * @brief ADT BTree.
- * Models a BTree of T.
+ * Models a BTree of T whose nodes use the augment policy Augment.
+ * @see BTNoAugment
  */
-template<class T>
+template<class T, class Augment = BTNoAugment>
 class BTree
 {
   public:
@@ -140,7 +737,14 @@ class BTree
      * facility, possibly sharing that management with other objects.
      * @see http://www.cplusplus.com/reference/memory/shared_ptr/
      */
-    typedef std::shared_ptr< BTree<T> > Ref;
+    typedef std::shared_ptr< BTree<T, Augment> > Ref;
+
+    /** @brief The type of the nodes.*/
+    typedef BTNode<T, Augment> node_type;
+
+    /** @brief Iterates over the items in infix order.*/
+    typedef BTreeInfixIterator<T, node_type> const_iterator;
+    typedef const_iterator iterator;
 
   /** @name Life cicle.*/
   /** @{*/
@@ -158,7 +762,7 @@ class BTree
    */
   BTree (const T& item)
   {
-      auto leaf = BTNode<T>::create(item);
+      auto leaf = node_type::create(item);
       root_ = leaf;
   }
 
@@ -166,9 +770,9 @@ class BTree
    * @brief Create an empty BTree.
    * @return a shared referente to the new tree.
    */
-  static typename BTree<T>::Ref create()
+  static typename BTree<T, Augment>::Ref create()
   {
-      return std::make_shared<BTree<T>> ();
+      return std::make_shared<BTree<T, Augment>> ();
   }
 
   /**
@@ -176,9 +780,9 @@ class BTree
    * @param item is the root's item.
    * @return a shared referente to the new tree.
    */
-  static typename BTree<T>::Ref create(T const& item)
+  static typename BTree<T, Augment>::Ref create(T const& item)
   {
-      return std::make_shared<BTree<T>>(item);
+      return std::make_shared<BTree<T, Augment>>(item);
   }
 
   /**
@@ -194,28 +798,78 @@ class BTree
    * @return a reference to the tree created.
    * @warning runtime_error will throw if worng input format was found.
    */
-  static typename BTree<T>::Ref create (std::istream& in) noexcept(false)
+  static typename BTree<T, Augment>::Ref create (std::istream& in) noexcept(false)
   {
-      auto tree = BTree<T>::create();
-      std::string token;
-      in >> token;
-      if (!in)
-          throw std::runtime_error("Wrong input format.");
+      BTreeStreamTokenizer tokens (in);
+      return unfold(tokens);
+  }
 
-      T new_item;
+  /**
+   * @brief Load a tree from a memory buffer.
+   * The format is the same as for create(std::istream&) and the bytes
+   * following the tree are ignored.
+   * @param data,
+   * @param size specify the buffer.
+   * @return a reference to the tree created.
+   * @warning runtime_error will throw if worng input format was found.
+   */
+  static typename BTree<T, Augment>::Ref create (const char* data, size_t size) noexcept(false)
+  {
+      BTreeBufferTokenizer tokens (data, size);
+      return unfold(tokens);
+  }
 
-      if(token != "[]")
+  /**
+   * @brief Load a tree from a file.
+   * The file is mapped in memory when the platform allows it, else it is
+   * read in a buffer.
+   * @param filename is the file's name.
+   * @return a reference to the tree created.
+   * @warning runtime_error will throw if the file could not be read or
+   * worng input format was found.
+   */
+  static typename BTree<T, Augment>::Ref load (std::string const& filename) noexcept(false)
+  {
+#if defined(__unix__) || defined(__APPLE__)
+      const int fd = ::open(filename.c_str(), O_RDONLY);
+      if (fd < 0)
+          throw std::runtime_error("could not open input filename '"
+                                   + filename + "'.");
+      struct stat st;
+      if (::fstat(fd, &st) == 0 && S_ISREG(st.st_mode) && st.st_size > 0)
       {
-          while (in >> token && token != "]")
+          const size_t size = size_t(st.st_size);
+          void* data = ::mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+          if (data != MAP_FAILED)
           {
-              std::istringstream inputstream(token);
-              inputstream >> new_item;
-              tree->create_root(new_item);
-              tree->set_left(BTree<T>::create(in));
-              tree->set_right(BTree<T>::create(in));
+              ::close(fd);
+#ifdef MADV_SEQUENTIAL
+              ::madvise(data, size, MADV_SEQUENTIAL);
+#endif
+              typename BTree<T, Augment>::Ref tree;
+              try
+              {
+                  tree = create(static_cast<const char*>(data), size);
+              }
+              catch (...)
+              {
+                  ::munmap(data, size);
+                  throw;
+              }
+              ::munmap(data, size);
+              return tree;
           }
       }
-      return tree;
+      ::close(fd);
+#endif
+      //Not a regular file or it could not be mapped.
+      std::ifstream input (filename, std::ios::binary);
+      if (!input)
+          throw std::runtime_error("could not open input filename '"
+                                   + filename + "'.");
+      const std::string data ((std::istreambuf_iterator<char>(input)),
+                              std::istreambuf_iterator<char>());
+      return create(data.data(), data.size());
   }
 
   /** @brief Destroy a BTree.**/
@@ -244,17 +898,70 @@ class BTree
       return root_->item();
   }
 
+  /** @name Iterators.
+   * The tree must not be modified while iterating.
+   */
+  /** @{*/
+
+  /** @brief First item in infix order.*/
+  const_iterator begin() const
+  {
+      return const_iterator(root_.get());
+  }
+
+  /** @brief End of the items.*/
+  const_iterator end() const
+  {
+      return const_iterator();
+  }
+
+  /** @brief The items in prefix order.*/
+  BTreeRange< BTreePrefixIterator<T, node_type> > prefix() const
+  {
+      return BTreeRange< BTreePrefixIterator<T, node_type> >(root_.get());
+  }
+
+  /** @brief The items in infix order.*/
+  BTreeRange< BTreeInfixIterator<T, node_type> > infix() const
+  {
+      return BTreeRange< BTreeInfixIterator<T, node_type> >(root_.get());
+  }
+
+  /** @brief The items in postfix order.*/
+  BTreeRange< BTreePostfixIterator<T, node_type> > postfix() const
+  {
+      return BTreeRange< BTreePostfixIterator<T, node_type> >(root_.get());
+  }
+
+  /** @brief The items in breadth first order.*/
+  BTreeRange< BTreeBreadthFirstIterator<T, node_type> > breadth_first() const
+  {
+      return BTreeRange< BTreeBreadthFirstIterator<T, node_type> >(root_.get());
+  }
+
+  /** @}*/
+
+  /**
+   * @brief Get the root node.
+   * The traversals walk the nodes from here without creating subtrees.
+   * @return the root node, nullptr if the tree is empty.
+   */
+  typename node_type::Ref const& root() const
+  {
+      return root_;
+  }
+
   /**
    * @brief Get the left subtree.
    * @return a reference to the left subtree.
    * @pre !is_empty()
    */
-  typename BTree<T>::Ref left() const
+  typename BTree<T, Augment>::Ref left() const
   {
       assert(!is_empty());
-      BTree<T>::Ref l_subtree;
+      BTree<T, Augment>::Ref l_subtree;
 
-      auto leftTree = BTree<T>::create();
+      auto leftTree = BTree<T, Augment>::create();
 
       leftTree->root_ = root_->left();
 
@@ -268,12 +975,12 @@ class BTree
    * @return a reference to the right subtree.
    * @pre !is_empty()
    */
-  typename BTree<T>::Ref right() const
+  typename BTree<T, Augment>::Ref right() const
   {
       assert(!is_empty());
-      BTree<T>::Ref r_subtree;
+      BTree<T, Augment>::Ref r_subtree;
 
-      auto rightTree = BTree<T>::create();
+      auto rightTree = BTree<T, Augment>::create();
 
       rightTree->root_ = root_->right();
 
@@ -299,22 +1006,53 @@ class BTree
    */
   std::ostream& fold(std::ostream& out) const
   {
+      //The first bracket goes through the stream to use its width as
+      //operator<< does, the rest is written in blocks.
       out << "[";
-
-      if(!is_empty())
+      std::string buffer;
+      buffer.reserve(FOLD_BLOCK_SIZE);
+      std::ostringstream item_out;
+      item_out.copyfmt(out);
+      item_out.width(0);
+      const bool by_hand = BTreeItemFormat<T>::by_hand
+              && default_number_format(out);
+      fold_blocks(buffer, [&](T const& item, std::string& buffer)
       {
-          out << " " << root_->item() << " ";
-          left()->fold(out);
-          out << " ";
-          right()->fold(out);
-          out << " ";
-      }
-
-      out << "]";
-
+          if (by_hand)
+              BTreeItemFormat<T>::format(item, buffer, item_out);
+          else
+          {
+              item_out.str(std::string());
+              item_out << item;
+              buffer += item_out.str();
+          }
+      }, [&](std::string& buffer)
+      {
+          out.write(buffer.data(), std::streamsize(buffer.size()));
+          buffer.clear();
+      });
       return out;
   }
 
+  /**
+   * @brief Fold a binary tree appending the output to a string.
+   * The output is the same as fold(std::ostream&) with a stream in its
+   * default format, and buffer can be reused between calls to avoid
+   * allocations.
+   * @param buffer is the output.
+   * @return buffer.
+   */
+  std::string& fold(std::string& buffer) const
+  {
+      std::ostringstream item_out;
+      buffer += "[";
+      fold_blocks(buffer, [&](T const& item, std::string& buffer)
+      {
+          BTreeItemFormat<T>::format(item, buffer, item_out);
+      }, [](std::string&) {});
+      return buffer;
+  }
+
   /** @}*/
 
   /** @name Modifiers*/
@@ -338,10 +1076,20 @@ class BTree
    */
   void create_root(T const& item)
   {
-      root_ = BTNode<T>::create(item);
+      root_ = node_type::create(item);
       assert(!is_empty());
   }
 
+  /**
+   * @brief Link a node as the root.
+   * @param root is the new root node, nullptr to empty the tree.
+   * @post is_empty() == (root == nullptr)
+   */
+  void set_root(typename node_type::Ref root)
+  {
+      root_ = std::move(root);
+  }
+
   /**
    * @brief Remove the link to the root node.
    * @post is_empty()
@@ -357,7 +1105,7 @@ class BTree
    * @param new_left is the new left subtree.
    * @pre !is_empty()
    */
-  void set_left(typename BTree<T>::Ref new_left)
+  void set_left(typename BTree<T, Augment>::Ref new_left)
   {
       assert(!is_empty());
 
@@ -378,7 +1126,7 @@ class BTree
    * @brief Attach a new subtree as right child of root.
    * @param t is the new right subtree.
    */
-  void set_right(typename BTree<T>::Ref t)
+  void set_right(typename BTree<T, Augment>::Ref t)
   {
       assert(!is_empty());
       root_->set_right(t->root_);
@@ -398,7 +1146,165 @@ class BTree
 
 protected:
 
-  typename BTNode<T>::Ref root_;
+  /** @brief Size of the blocks written by fold(std::ostream&).*/
+  static const size_t FOLD_BLOCK_SIZE = 1 << 16;
+
+  /**
+   * @brief Build a tree reading its tokens.
+   * It works as if create(std::istream&) were called recursively for each
+   * subtree, keeping the pending subtrees in a stack.
+   */
+  template <class Tokenizer>
+  static typename BTree<T, Augment>::Ref unfold(Tokenizer& tokens) noexcept(false)
+  {
+      //A subtree being read: its items and "]", or its left or right child.
+      enum Reading { ITEMS, LEFT, RIGHT };
+      struct Frame
+      {
+          typename node_type::Ref node;
+          Reading reading;
+      };
+      std::vector<Frame> frames;
+      std::istringstream item_in;
+      T new_item;
+      typename node_type::Ref subtree;
+      const char* first = nullptr;
+      const char* last = nullptr;
+      bool start = true;
+      for (;;)
+      {
+          bool subtree_read = false;
+          if (start)
+          {
+              //The first token of a subtree: "[]" or any other one.
+              start = false;
+              if (!tokens.next(first, last))
+                  throw std::runtime_error("Wrong input format.");
+              if (is_token(first, last, "[]"))
+              {
+                  subtree = nullptr;
+                  subtree_read = true;
+              }
+              else
+                  frames.push_back(Frame{nullptr, ITEMS});
+          }
+          else if (!tokens.next(first, last) || is_token(first, last, "]"))
+          {
+              subtree = std::move(frames.back().node);
+              frames.pop_back();
+              subtree_read = true;
+          }
+          else
+          {
+              //A new item replaces the root and its children are read.
+              BTreeItemFormat<T>::parse(first, last, new_item, item_in);
+              frames.back().node = node_type::create(new_item);
+              frames.back().reading = LEFT;
+              start = true;
+          }
+
+          if (subtree_read)
+          {
+              if (frames.empty())
+                  break;
+              Frame& parent = frames.back();
+              if (parent.reading == LEFT)
+              {
+                  parent.node->set_left(std::move(subtree));
+                  parent.reading = RIGHT;
+                  start = true;
+              }
+              else
+              {
+                  parent.node->set_right(std::move(subtree));
+                  parent.reading = ITEMS;
+              }
+          }
+      }
+      auto tree = BTree<T, Augment>::create();
+      tree->root_ = std::move(subtree);
+      return tree;
+  }
+
+  /** @brief Is the token [first, last) equal to text?*/
+  static bool is_token(const char* first, const char* last, const char* text)
+  {
+      const size_t size = std::char_traits<char>::length(text);
+      return size_t(last - first) == size
+              && std::char_traits<char>::compare(first, text, size) == 0;
+  }
+
+  /** @brief Does out write the integers as BTreeItemFormat::format?*/
+  static bool default_number_format(std::ostream& out)
+  {
+      const std::ios_base::fmtflags base = out.flags() & std::ios_base::basefield;
+      return (base == std::ios_base::dec || base == 0)
+              && !(out.flags() & std::ios_base::showpos)
+              && std::use_facet< std::numpunct<char> >(out.getloc()).grouping().empty();
+  }
+
+  /**
+   * @brief Fold the tree after its first "[" walking the nodes with a stack.
+   * @param buffer is the output.
+   * @param format appends an item to the buffer.
+   * @param flush is called when the buffer reaches FOLD_BLOCK_SIZE bytes
+   * and at the end.
+   */
+  template <class Format, class Flush>
+  void fold_blocks(std::string& buffer, Format format, Flush flush) const
+  {
+      //The nodes whose subtrees are being folded, right is true once the
+      //left subtree was written.
+      struct Pending
+      {
+          node_type const* node;
+          bool right;
+      };
+      std::vector<Pending> pending;
+      node_type const* next = root_.get();
+      if (next != nullptr)
+      {
+          buffer.push_back(' ');
+          format(next->item(), buffer);
+          buffer.push_back(' ');
+          pending.push_back(Pending{next, false});
+          next = next->left().get();
+      }
+      else
+      {
+          buffer.push_back(']');
+      }
+      while (!pending.empty())
+      {
+          for (; next != nullptr; next = next->left().get())
+          {
+              buffer.push_back('[');
+              buffer.push_back(' ');
+              format(next->item(), buffer);
+              buffer.push_back(' ');
+              pending.push_back(Pending{next, false});
+          }
+          buffer.push_back('[');
+          buffer.push_back(']');
+          while (!pending.empty() && pending.back().right)
+          {
+              buffer.push_back(' ');
+              buffer.push_back(']');
+              pending.pop_back();
+          }
+          if (!pending.empty())
+          {
+              buffer.push_back(' ');
+              pending.back().right = true;
+              next = pending.back().node->right().get();
+          }
+          if (buffer.size() >= FOLD_BLOCK_SIZE)
+              flush(buffer);
+      }
+      flush(buffer);
+  }
+
+  typename node_type::Ref root_;
 
 };
 #endif
@@ -0,0 +1,580 @@
+#ifndef __ED_BTreeImage_HPP__
+#define __ED_BTreeImage_HPP__
+
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#include "btree.hpp"
+
+/**
+ * @brief Header of a binary BTree image.
+ *
+ * The image is the header followed by three blocks, each one starting at a
+ * multiple of 8 bytes:
+ * - the structure bitmap, two bits per node in prefix order: bit 2i is set
+ *   if the node i has a left child and bit 2i+1 if it has a right child.
+ * - optionally, the index of the right child of each node as an uint32_t,
+ *   or NIL. The left child of the node i is always the node i+1.
+ * - the items in prefix order.
+ *
+ * All the fields are written in the byte order of the machine.
+ */
+struct BTreeImageHeader
+{
+    char magic[4];
+    std::uint32_t byte_order;
+    std::uint32_t version;
+    std::uint32_t item_size;
+    std::uint32_t flags;
+    std::uint32_t reserved;
+    std::uint64_t size;
+};
+
+/**
+ * @brief A read only BTree of trivially copyable items kept in its binary
+ * image.
+ *
+ * The image can be a buffer or a file mapped in memory and the tree is
+ * queried in place, so loading it only costs checking its structure.
+ */
+template <class T>
+class BTreeImage
+{
+    static_assert(std::is_trivially_copyable<T>::value,
+                  "the items of a BTree image must be trivially copyable.");
+    static_assert(alignof(T) <= 8,
+                  "the items of a BTree image must be aligned to 8 bytes or less.");
+
+public:
+
+    /** @brief Define a shared reference to a BTreeImage.*/
+    typedef std::shared_ptr< BTreeImage<T> > Ref;
+
+    /** @brief Position of a node in prefix order.*/
+    typedef std::uint32_t Index;
+
+    /** @brief The index of a missing child.*/
+    static constexpr Index NIL = UINT32_MAX;
+
+    /** @brief Flag of the images storing the right children indices.*/
+    static constexpr std::uint32_t RIGHT_INDEX = 1;
+
+    /** @name Life cicle.*/
+    /** @{*/
+
+    /**
+     * @brief Create a view of an image.
+     * @param data,
+     * @param size specify the image, it must outlive the view.
+     * @warning throw std::runtime_error("Wrong BTree image.") if it is not
+     * a valid image of a tree of T.
+     */
+    BTreeImage(const char* data, size_t size) noexcept(false)
+        : data_(data)
+    {
+        open(size);
+    }
+
+    /**
+     * @brief Create a view of an image.
+     * @see BTreeImage(const char*, size_t)
+     * @return a shared reference to the view.
+     */
+    static typename BTreeImage<T>::Ref create(const char* data, size_t size) noexcept(false)
+    {
+        return std::make_shared< BTreeImage<T> >(data, size);
+    }
+
+    /**
+     * @brief Load an image from a file.
+     * The file is mapped in memory when the platform allows it, else it is
+     * read in a buffer.
+     * @param filename is the file's name.
+     * @return a shared reference to the image.
+     * @warning throw std::runtime_error if the file could not be read or it
+     * is not a valid image.
+     */
+    static typename BTreeImage<T>::Ref load(std::string const& filename) noexcept(false)
+    {
+        std::shared_ptr<const char> storage;
+        size_t size = 0;
+#if defined(__unix__) || defined(__APPLE__)
+        const int fd = ::open(filename.c_str(), O_RDONLY);
+        if (fd < 0)
+            throw std::runtime_error("could not open input filename '"
+                                     + filename + "'.");
+        struct stat st;
+        if (::fstat(fd, &st) == 0 && S_ISREG(st.st_mode) && st.st_size > 0)
+        {
+            size = size_t(st.st_size);
+            void* data = ::mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+            if (data != MAP_FAILED)
+                storage.reset(static_cast<const char*>(data), [size](const char* p)
+                {
+                    ::munmap(const_cast<char*>(p), size);
+                });
+        }
+        ::close(fd);
+#endif
+        if (storage == nullptr)
+        {
+            //Not a regular file or it could not be mapped.
+            std::ifstream input (filename, std::ios::binary);
+            if (!input)
+                throw std::runtime_error("could not open input filename '"
+                                         + filename + "'.");
+            auto buffer = std::make_shared< std::vector<char> >(
+                        (std::istreambuf_iterator<char>(input)),
+                        std::istreambuf_iterator<char>());
+            size = buffer->size();
+            storage = std::shared_ptr<const char>(buffer, buffer->data());
+        }
+        auto image = create(storage.get(), size);
+        image->storage_ = storage;
+        return image;
+    }
+
+    /**
+     * @brief Write the image of a tree.
+     * @param tree is the tree.
+     * @param out is the output stream.
+     * @param right_index is true to store the right children indices, so
+     * right() takes constant time.
+     * @pre tree!=nullptr
+     * @warning throw std::runtime_error("Tree too large.") if the tree has
+     * more nodes than the indices can address.
+     */
+    static void save(typename BTree<T>::Ref const& tree, std::ostream& out,
+                     bool right_index = true) noexcept(false)
+    {
+        assert(tree != nullptr);
+        std::vector<unsigned char> bits;
+        std::vector<Index> rights;
+        std::vector<T> items;
+
+        //Each pending node carries its parent if it is a right child.
+        std::vector< std::pair<BTNode<T> const*, Index> > pending;
+        if (tree->root() != nullptr)
+            pending.push_back(std::make_pair(tree->root().get(), NIL));
+        while (!pending.empty())
+        {
+            const auto next = pending.back();
+            pending.pop_back();
+            if (items.size() >= NIL)
+                throw std::runtime_error("Tree too large.");
+            const Index i = Index(items.size());
+            if (next.second != NIL)
+                rights[next.second] = i;
+            items.push_back(next.first->item());
+            rights.push_back(NIL);
+            if (i % 4 == 0)
+                bits.push_back(0);
+            if (next.first->has_left())
+                bits.back() |= 1 << (2 * (i % 4));
+            if (next.first->has_right())
+            {
+                bits.back() |= 2 << (2 * (i % 4));
+                pending.push_back(std::make_pair(next.first->right().get(), i));
+            }
+            if (next.first->has_left())
+                pending.push_back(std::make_pair(next.first->left().get(), NIL));
+        }
+
+        BTreeImageHeader header;
+        std::memcpy(header.magic, MAGIC, sizeof(header.magic));
+        header.byte_order = BYTE_ORDER_MARK;
+        header.version = VERSION;
+        header.item_size = sizeof(T);
+        header.flags = right_index ? RIGHT_INDEX : 0;
+        header.reserved = 0;
+        header.size = items.size();
+        out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+        write_block(out, bits.data(), bits.size());
+        if (right_index)
+            write_block(out, rights.data(), rights.size() * sizeof(Index));
+        write_block(out, items.data(), items.size() * sizeof(T));
+    }
+
+    /**
+     * @brief Create a BTree with the same shape and items.
+     * @return a reference to the new tree.
+     */
+    typename BTree<T>::Ref to_btree() const
+    {
+        auto tree = BTree<T>::create();
+        if (!is_empty())
+        {
+            //Children are stored after their parent, so walking the nodes
+            //backwards creates the subtrees before they are linked.
+            const std::vector<Index> rights = right_children();
+            std::vector< typename BTNode<T>::Ref > subtrees (size());
+            for (Index i = Index(size()); i-- > 0;)
+            {
+                typename BTNode<T>::Ref l, r;
+                if (has_left(i))
+                    l = std::move(subtrees[i + 1]);
+                if (rights[i] != NIL)
+                    r = std::move(subtrees[rights[i]]);
+                subtrees[i] = BTNode<T>::create(item(i), std::move(l), std::move(r));
+            }
+            tree->create_root(item(0));
+            tree->root()->set_left(subtrees[0]->left());
+            tree->root()->set_right(subtrees[0]->right());
+        }
+        return tree;
+    }
+
+    /** @}*/
+
+    /** @name Observers*/
+    /** @{*/
+
+    /** @brief is the tree empty?.*/
+    bool is_empty() const
+    {
+        return size_ == 0;
+    }
+
+    /** @brief Number of nodes.*/
+    size_t size() const
+    {
+        return size_;
+    }
+
+    /** @brief Has the image the right children indices?*/
+    bool has_right_index() const
+    {
+        return rights_ != nullptr;
+    }
+
+    /** @brief Index of the root node, NIL if the tree is empty.*/
+    Index root() const
+    {
+        return is_empty() ? NIL : 0;
+    }
+
+    /**
+     * @brief Get the item of a node.
+     * @pre i < size()
+     */
+    T const& item(Index i) const
+    {
+        assert(i < size());
+        return items_[i];
+    }
+
+    /** @brief The items in prefix order.*/
+    T const* items() const
+    {
+        return items_;
+    }
+
+    /** @pre i < size()*/
+    bool has_left(Index i) const
+    {
+        assert(i < size());
+        return (bits_[i / 4] >> (2 * (i % 4))) & 1;
+    }
+
+    /** @pre i < size()*/
+    bool has_right(Index i) const
+    {
+        assert(i < size());
+        return (bits_[i / 4] >> (2 * (i % 4))) & 2;
+    }
+
+    /**
+     * @brief Get the left child of a node.
+     * @return its index or NIL.
+     * @pre i < size()
+     */
+    Index left(Index i) const
+    {
+        return has_left(i) ? i + 1 : NIL;
+    }
+
+    /**
+     * @brief Get the right child of a node.
+     * Without the right index, it skips the left subtree in the bitmap.
+     * @return its index or NIL.
+     * @pre i < size()
+     */
+    Index right(Index i) const
+    {
+        if (!has_right(i))
+            return NIL;
+        if (rights_ != nullptr)
+            return right_index(i);
+        //Count the children still to be visited until the left subtree ends.
+        Index next = i + 1;
+        for (size_t open = has_left(i) ? 1 : 0; open > 0; ++next)
+            open += size_t(has_left(next)) + size_t(has_right(next)) - 1;
+        return next;
+    }
+
+    /**
+     * @brief Get the right child of every node.
+     * @return the index of the right child of each node or NIL.
+     */
+    std::vector<Index> right_children() const
+    {
+        std::vector<Index> rights (size(), NIL);
+        std::vector<Index> waiting;
+        for (Index i = 0; i < size(); ++i)
+        {
+            if (i > 0 && !has_left(i - 1))
+            {
+                rights[waiting.back()] = i;
+                waiting.pop_back();
+            }
+            if (has_right(i))
+                waiting.push_back(i);
+        }
+        return rights;
+    }
+
+    /**
+     * @brief Fold the tree.
+     * The output format is the same as BTree::fold().
+     * @param out is the output stream.
+     * @return the output stream.
+     */
+    std::ostream& fold(std::ostream& out) const
+    {
+        return to_btree()->fold(out);
+    }
+
+    /** @}*/
+
+protected:
+
+    static constexpr char MAGIC[4] = { 'E', 'D', 'B', 'T' };
+    static constexpr std::uint32_t BYTE_ORDER_MARK = 0x01020304;
+    static constexpr std::uint32_t VERSION = 1;
+
+    /** @brief Size of a block rounded up to a multiple of 8 bytes.*/
+    static size_t padded(size_t bytes)
+    {
+        return (bytes + 7) / 8 * 8;
+    }
+
+    /** @brief Write a block followed by its padding.*/
+    static void write_block(std::ostream& out, const void* data, size_t bytes)
+    {
+        static const char zeros[8] = {};
+        out.write(static_cast<const char*>(data), std::streamsize(bytes));
+        out.write(zeros, std::streamsize(padded(bytes) - bytes));
+    }
+
+    /**
+     * @brief Check the image and locate its blocks.
+     * The structure bitmap and the right index are checked in a single
+     * pass, so a corrupted image can not make the queries go out of it.
+     */
+    void open(size_t bytes) noexcept(false)
+    {
+        BTreeImageHeader header;
+        if (bytes < sizeof(header))
+            throw std::runtime_error("Wrong BTree image.");
+        std::memcpy(&header, data_, sizeof(header));
+        if (std::memcmp(header.magic, MAGIC, sizeof(header.magic)) != 0
+                || header.byte_order != BYTE_ORDER_MARK
+                || header.version != VERSION
+                || header.item_size != sizeof(T)
+                || (header.flags & ~RIGHT_INDEX) != 0
+                || header.size >= NIL)
+            throw std::runtime_error("Wrong BTree image.");
+        size_ = size_t(header.size);
+        const size_t bits_offset = sizeof(header);
+        const size_t rights_offset = bits_offset + padded((2 * size_ + 7) / 8);
+        const size_t items_offset = rights_offset
+                + ((header.flags & RIGHT_INDEX) ? padded(size_ * sizeof(Index)) : 0);
+        if (bytes < items_offset + size_ * sizeof(T)
+                || reinterpret_cast<std::uintptr_t>(data_ + items_offset) % alignof(T) != 0)
+            throw std::runtime_error("Wrong BTree image.");
+        bits_ = reinterpret_cast<const unsigned char*>(data_ + bits_offset);
+        rights_ = (header.flags & RIGHT_INDEX) ? data_ + rights_offset : nullptr;
+        items_ = reinterpret_cast<T const*>(data_ + items_offset);
+
+        //Each node must be the left child of the previous one or the right
+        //child of the last node still waiting for it.
+        std::vector<Index> waiting;
+        for (Index i = 0; i < size_; ++i)
+        {
+            if (i > 0 && !has_left(i - 1))
+            {
+                if (waiting.empty()
+                        || (rights_ != nullptr && right_index(waiting.back()) != i))
+                    throw std::runtime_error("Wrong BTree image.");
+                waiting.pop_back();
+            }
+            if (has_right(i))
+                waiting.push_back(i);
+            else if (rights_ != nullptr && right_index(i) != NIL)
+                throw std::runtime_error("Wrong BTree image.");
+        }
+        if (!waiting.empty() || (size_ > 0 && has_left(Index(size_ - 1))))
+            throw std::runtime_error("Wrong BTree image.");
+    }
+
+    /** @brief The stored right index of a node.*/
+    Index right_index(Index i) const
+    {
+        Index r;
+        std::memcpy(&r, rights_ + i * sizeof(Index), sizeof(Index));
+        return r;
+    }
+
+    const char* data_;
+    std::shared_ptr<const char> storage_;
+    size_t size_;
+    const unsigned char* bits_;
+    const char* rights_;
+    T const* items_;
+};
+
+template <class T>
+constexpr typename BTreeImage<T>::Index BTreeImage<T>::NIL;
+
+template <class T>
+constexpr std::uint32_t BTreeImage<T>::RIGHT_INDEX;
+
+template <class T>
+constexpr char BTreeImage<T>::MAGIC[4];
+
+template <class T>
+constexpr std::uint32_t BTreeImage<T>::BYTE_ORDER_MARK;
+
+template <class T>
+constexpr std::uint32_t BTreeImage<T>::VERSION;
+
+/**
+ * @brief Prefix processing of a tree image.
+ * Processor has the same interface as for prefix_process(BTree). The items
+ * are stored in prefix order, so this is a sequential scan.
+ * @return true if all nodes were processed.
+ */
+template <class T, typename Processor>
+bool
+prefix_process(BTreeImage<T> const& tree, Processor& p)
+{
+    bool retVal = true;
+    for (size_t i = 0; retVal && i < tree.size(); ++i)
+        retVal = p(tree.items()[i]);
+    return retVal;
+}
+
+/**
+ * @brief Infix processing of a tree image.
+ * Processor has the same interface as for infix_process(BTree).
+ * @return true if all nodes were processed.
+ */
+template <class T, typename Processor>
+bool
+infix_process(BTreeImage<T> const& tree, Processor& p)
+{
+    typedef typename BTreeImage<T>::Index Index;
+    bool retVal = true;
+    //The nodes whose left subtree is being processed.
+    std::vector<Index> pending;
+    for (Index i = 0; retVal && i < tree.size(); ++i)
+    {
+        if (tree.has_left(i))
+        {
+            pending.push_back(i);
+            continue;
+        }
+        retVal = p(tree.item(i));
+        //Without a right child, the ancestors whose left subtree ends here
+        //come next.
+        Index last = i;
+        while (retVal && !tree.has_right(last) && !pending.empty())
+        {
+            last = pending.back();
+            pending.pop_back();
+            retVal = p(tree.item(last));
+        }
+    }
+    return retVal;
+}
+
+/**
+ * @brief Postfix processing of a tree image.
+ * Processor has the same interface as for postfix_process(BTree).
+ * @return true if all nodes were processed.
+ */
+template <class T, typename Processor>
+bool
+postfix_process(BTreeImage<T> const& tree, Processor& p)
+{
+    typedef typename BTreeImage<T>::Index Index;
+    bool retVal = true;
+    //The nodes with children to process and how many remain.
+    std::vector< std::pair<Index, int> > pending;
+    for (Index i = 0; retVal && i < tree.size(); ++i)
+    {
+        const int children = int(tree.has_left(i)) + int(tree.has_right(i));
+        if (children > 0)
+        {
+            pending.push_back(std::make_pair(i, children));
+            continue;
+        }
+        retVal = p(tree.item(i));
+        while (retVal && !pending.empty() && --pending.back().second == 0)
+        {
+            retVal = p(tree.item(pending.back().first));
+            pending.pop_back();
+        }
+    }
+    return retVal;
+}
+
+/**
+ * @brief Breadth first processing of a tree image.
+ * Processor has the same interface as for breadth_first_process(BTree).
+ * @return true if all nodes were processed.
+ */
+template <class T, typename Processor>
+bool
+breadth_first_process(BTreeImage<T> const& tree, Processor& p)
+{
+    typedef typename BTreeImage<T>::Index Index;
+    bool retVal = true;
+    std::vector<Index> rights;
+    if (!tree.has_right_index())
+        rights = tree.right_children();
+    std::vector<Index> queue;
+    queue.reserve(tree.size());
+    if (!tree.is_empty())
+        queue.push_back(tree.root());
+    for (size_t head = 0; retVal && head < queue.size(); ++head)
+    {
+        const Index i = queue[head];
+        retVal = p(tree.item(i));
+        if (tree.has_left(i))
+            queue.push_back(i + 1);
+        if (tree.has_right(i))
+            queue.push_back(rights.empty() ? tree.right(i) : rights[i]);
+    }
+    return retVal;
+}
+
+#endif //__ED_BTreeImage_HPP__
@@ -1,11 +1,17 @@
 #ifndef __ED_BTree_Utils_HPP__
 #define __ED_BTree_Utils_HPP__
 
+#include <algorithm>
+#include <atomic>
 #include <cassert>
 #include <exception>
+#include <functional>
 #include <memory>
 #include <iostream>
 #include <queue>
+#include <thread>
+#include <utility>
+#include <vector>
 
 
 #include "btree.hpp"
@@ -19,17 +25,35 @@
  * @return the tree's height or -1 if it is a empty tree.
  * @pre t!=nullptr
  */
-template<class T>
-int compute_height (typename BTree<T>::Ref t)
+template<class T, class Augment>
+int compute_height (std::shared_ptr< BTree<T, Augment> > t)
 {
     assert(t != nullptr);
     int ret_val = -1;
 
+    //Walk the nodes with an explicit stack of (node, depth).
+    std::vector< std::pair<BTNode<T, Augment> const*, int> > pending;
     if (!t->is_empty())
     {
-        int left = compute_height<T>(t->left()) + 1;
-        int right = compute_height<T>(t->right()) + 1;
-        (left >= right) ? ret_val = left : ret_val = right;
+        pending.push_back(std::make_pair(t->root().get(), 0));
+    }
+    while (!pending.empty())
+    {
+        BTNode<T, Augment> const* node = pending.back().first;
+        const int depth = pending.back().second;
+        pending.pop_back();
+        if (depth > ret_val)
+        {
+            ret_val = depth;
+        }
+        if (node->has_right())
+        {
+            pending.push_back(std::make_pair(node->right().get(), depth + 1));
+        }
+        if (node->has_left())
+        {
+            pending.push_back(std::make_pair(node->left().get(), depth + 1));
+        }
     }
 
     return ret_val;
@@ -45,15 +69,30 @@ int compute_height (typename BTree<T>::Ref t)
  * @post t->is_empty() and ret_val==0
  * @post !t->is_empty() and ret_val>0
  */
-template<class T>
-size_t compute_size (typename BTree<T>::Ref t)
+template<class T, class Augment>
+size_t compute_size (std::shared_ptr< BTree<T, Augment> > t)
 {
     assert(t != nullptr);
     size_t ret_val = 0;
 
-    if(!t->is_empty())
+    std::vector<BTNode<T, Augment> const*> pending;
+    if (!t->is_empty())
     {
-        ret_val = compute_size<T>(t->left()) + compute_size<T>(t->right()) + 1;
+        pending.push_back(t->root().get());
+    }
+    while (!pending.empty())
+    {
+        BTNode<T, Augment> const* node = pending.back();
+        pending.pop_back();
+        ++ret_val;
+        if (node->has_left())
+        {
+            pending.push_back(node->left().get());
+        }
+        if (node->has_right())
+        {
+            pending.push_back(node->right().get());
+        }
     }
 
     assert(!t->is_empty() || ret_val==0);
@@ -62,6 +101,316 @@ size_t compute_size (typename BTree<T>::Ref t)
 }
 
 
+/**
+ * @brief Get the height of a tree whose nodes keep it, in O(1).
+ * @see compute_height
+ * @pre t!=nullptr
+ */
+template<class T>
+int compute_height (std::shared_ptr< BTree<T, BTSizeHeightAugment> > t)
+{
+    assert(t != nullptr);
+    return t->is_empty() ? -1 : t->root()->height();
+}
+
+/**
+ * @brief Get the number of nodes of a tree whose nodes keep it, in O(1).
+ * @see compute_size
+ * @pre t!=nullptr
+ */
+template<class T>
+size_t compute_size (std::shared_ptr< BTree<T, BTSizeHeightAugment> > t)
+{
+    assert(t != nullptr);
+    return t->is_empty() ? 0 : t->root()->size();
+}
+
+/**
+ * @brief Reduce the subtree rooted at node.
+ *
+ * The value of an empty subtree is empty and the value of a node is
+ * combine(map(item), left value, right value). The nodes are visited in
+ * postfix order with an explicit stack, so degenerate trees are handled too.
+ *
+ * @return the value of the subtree.
+ */
+template <class Node, class R, class Map, class Combine>
+R reduce_nodes(Node const* node, R const& empty, Map& map,
+               Combine& combine)
+{
+    //Each inner node is pushed twice, the second time (expanded) to combine
+    //the values of its children, which are on the top of values.
+    std::vector< std::pair<Node const*, bool> > pending;
+    std::vector<R> values;
+    if (node != nullptr)
+        pending.push_back(std::make_pair(node, false));
+    while (!pending.empty())
+    {
+        Node const* current = pending.back().first;
+        const bool expanded = pending.back().second;
+        pending.pop_back();
+        if (!expanded && !current->has_left() && !current->has_right())
+        {
+            values.push_back(combine(map(current->item()), R(empty), R(empty)));
+        }
+        else if (!expanded)
+        {
+            pending.push_back(std::make_pair(current, true));
+            if (current->has_right())
+                pending.push_back(std::make_pair(current->right().get(), false));
+            if (current->has_left())
+                pending.push_back(std::make_pair(current->left().get(), false));
+        }
+        else
+        {
+            R right = empty;
+            if (current->has_right())
+            {
+                right = std::move(values.back());
+                values.pop_back();
+            }
+            R left = empty;
+            if (current->has_left())
+            {
+                left = std::move(values.back());
+                values.pop_back();
+            }
+            values.push_back(combine(map(current->item()), std::move(left),
+                                     std::move(right)));
+        }
+    }
+    return values.empty() ? empty : std::move(values.back());
+}
+
+/**
+ * @brief Count the nodes of two subtrees until one of them is done or both
+ * have at least limit nodes.
+ *
+ * Both subtrees are walked one node each in turn, so the cost is about twice
+ * the size of the smaller one and never more than 2*limit nodes.
+ *
+ * @return the sizes, exact for a subtree whose walk was ended and limit or
+ *         more for the other one.
+ */
+template <class Node>
+std::pair<size_t, size_t> subtree_sizes_up_to(Node const* left,
+                                              Node const* right, size_t limit)
+{
+    std::vector<Node const*> pending[2];
+    size_t sizes[2] = {0, 0};
+    if (left != nullptr)
+        pending[0].push_back(left);
+    if (right != nullptr)
+        pending[1].push_back(right);
+    while (!pending[0].empty() && !pending[1].empty() && sizes[0] < limit)
+    {
+        for (int side = 0; side < 2; ++side)
+        {
+            Node const* current = pending[side].back();
+            pending[side].pop_back();
+            ++sizes[side];
+            if (current->has_right())
+                pending[side].push_back(current->right().get());
+            if (current->has_left())
+                pending[side].push_back(current->left().get());
+        }
+    }
+    for (int side = 0; side < 2; ++side)
+        if (!pending[side].empty())
+            sizes[side] = std::max(sizes[side], limit);
+    return std::make_pair(sizes[0], sizes[1]);
+}
+
+/**
+ * @brief Get the sizes of two subtrees from the size cached by their nodes.
+ * @see subtree_sizes_up_to
+ */
+template <class T>
+std::pair<size_t, size_t> subtree_sizes_up_to(
+        BTNode<T, BTSizeHeightAugment> const* left,
+        BTNode<T, BTSizeHeightAugment> const* right, size_t)
+{
+    return std::make_pair(left == nullptr ? 0 : left->size(),
+                          right == nullptr ? 0 : right->size());
+}
+
+/**
+ * @brief Reduce the subtree rooted at node using n_threads threads.
+ *
+ * The tree is walked down while one of the children of the node has less
+ * than min_parallel_size nodes: that child is reduced by reduce_nodes in this
+ * thread and the walk goes on with the other one. At the first node whose
+ * both children are big enough, the left subtree is reduced in a new thread
+ * and the right one in this thread, the threads being split in proportion to
+ * the subtree sizes. The values of the walked nodes are combined back at the
+ * end, so skewed trees do not recurse.
+ *
+ * The sizes come from BTSizeHeightAugment when the nodes use it, otherwise
+ * they are counted up to min_parallel_size nodes.
+ *
+ * @return the value of the subtree.
+ */
+template <class Node, class R, class Map, class Combine>
+R parallel_reduce_nodes(Node const* node, R const& empty, Map& map,
+                        Combine& combine, unsigned n_threads,
+                        size_t min_parallel_size)
+{
+    /** A walked node with the value of its small child.*/
+    struct Step
+    {
+        Node const* node;
+        R small;
+        bool small_is_left;
+    };
+
+    std::vector<Step> chain;
+    std::pair<size_t, size_t> sizes (0, 0);
+    bool fork = false;
+    while (n_threads > 1 && node != nullptr
+           && (node->has_left() || node->has_right()))
+    {
+        Node const* left = node->left().get();
+        Node const* right = node->right().get();
+        sizes = subtree_sizes_up_to(left, right, min_parallel_size);
+        const bool left_big = sizes.first >= min_parallel_size;
+        const bool right_big = sizes.second >= min_parallel_size;
+        if (left_big == right_big)
+        {
+            fork = left_big;
+            break;
+        }
+        chain.push_back(Step{node, reduce_nodes(left_big ? right : left,
+                                                empty, map, combine),
+                             !left_big});
+        node = left_big ? left : right;
+    }
+
+    R value = empty;
+    if (fork)
+    {
+        unsigned left_threads = unsigned(
+                    (double(n_threads) * sizes.first) / (sizes.first + sizes.second)
+                    + 0.5);
+        left_threads = std::max(1u, std::min(n_threads - 1, left_threads));
+        R left = empty;
+        std::exception_ptr left_error;
+        std::thread worker ([&]()
+        {
+            try
+            {
+                left = parallel_reduce_nodes(node->left().get(), empty, map,
+                                             combine, left_threads,
+                                             min_parallel_size);
+            }
+            catch (...)
+            {
+                left_error = std::current_exception();
+            }
+        });
+        R right = empty;
+        try
+        {
+            right = parallel_reduce_nodes(node->right().get(), empty, map,
+                                          combine, n_threads - left_threads,
+                                          min_parallel_size);
+        }
+        catch (...)
+        {
+            worker.join();
+            throw;
+        }
+        worker.join();
+        if (left_error)
+            std::rethrow_exception(left_error);
+        value = combine(map(node->item()), std::move(left), std::move(right));
+    }
+    else
+        value = reduce_nodes(node, empty, map, combine);
+
+    for (auto i = chain.rbegin(); i != chain.rend(); ++i)
+    {
+        if (i->small_is_left)
+            value = combine(map(i->node->item()), std::move(i->small),
+                            std::move(value));
+        else
+            value = combine(map(i->node->item()), std::move(value),
+                            std::move(i->small));
+    }
+    return value;
+}
+
+/**
+ * @brief Reduce a tree using several threads.
+ *
+ * The value of the empty tree is empty and the value of a tree is
+ * combine(map(root item), left subtree value, right subtree value). For
+ * instance, with empty 0, map returning 1 and combine adding its arguments
+ * the value is the tree's size.
+ *
+ * map and combine are called concurrently from several threads, so they must
+ * not change shared state without synchronization.
+ *
+ * @param tree is the tree.
+ * @param empty is the value of the empty tree.
+ * @param map is a closure R map(T const& item).
+ * @param combine is a closure R combine(R item, R left, R right).
+ * @param n_threads is the number of threads, 0 means one for each hardware
+ *        thread.
+ * @param min_parallel_size is the minimum number of nodes of a subtree
+ *        reduced by a thread, so small trees use less threads.
+ * @return the tree's value.
+ * @pre tree!=nullptr
+ */
+template <class T, class Augment, class R, class Map, class Combine>
+R parallel_reduce(std::shared_ptr< BTree<T, Augment> > const& tree,
+                  R const& empty, Map map, Combine combine,
+                  unsigned n_threads = 0, size_t min_parallel_size = 1 << 15)
+{
+    assert(tree != nullptr);
+    if (n_threads == 0)
+        n_threads = std::max(1u, std::thread::hardware_concurrency());
+    return parallel_reduce_nodes(tree->root().get(), empty, map, combine,
+                                 n_threads, std::max<size_t>(1, min_parallel_size));
+}
+
+/**
+ * @brief Compute the height of a tree using several threads.
+ * @see compute_height, parallel_reduce.
+ * @pre t!=nullptr
+ * @post ret_val == compute_height(t)
+ */
+template<class T, class Augment>
+int parallel_compute_height (std::shared_ptr< BTree<T, Augment> > const& t,
+                             unsigned n_threads = 0,
+                             size_t min_parallel_size = 1 << 15)
+{
+    return parallel_reduce<T>(t, -1, [](T const&) { return 1; },
+                              [](int item, int left, int right)
+                              {
+                                  return item + std::max(left, right);
+                              },
+                              n_threads, min_parallel_size);
+}
+
+/**
+ * @brief Compute the number of nodes in the tree using several threads.
+ * @see compute_size, parallel_reduce.
+ * @pre t!=nullptr
+ * @post ret_val == compute_size(t)
+ */
+template<class T, class Augment>
+size_t parallel_compute_size (std::shared_ptr< BTree<T, Augment> > const& t,
+                              unsigned n_threads = 0,
+                              size_t min_parallel_size = 1 << 15)
+{
+    return parallel_reduce<T>(t, size_t(0), [](T const&) { return size_t(1); },
+                              [](size_t item, size_t left, size_t right)
+                              {
+                                  return item + left + right;
+                              },
+                              n_threads, min_parallel_size);
+}
+
 /**
  * @brief Prefix processing of a binary tree
  * The template class Processor must have an closure interface:
@@ -76,18 +425,17 @@ size_t compute_size (typename BTree<T>::Ref t)
  * @return true if all nodes were processed.
  * @pre tree!=nullptr
  */
-template <class T, typename Processor>
+template <class T, class Augment, typename Processor>
 bool
-prefix_process(typename BTree<T>::Ref tree, Processor& p)
+prefix_process(std::shared_ptr< BTree<T, Augment> > tree, Processor& p)
 {
     assert(tree != nullptr);
     bool retVal = true;
 
-    if(!tree->is_empty())
+    auto items = tree->prefix();
+    for (auto it = items.begin(); retVal && it != items.end(); ++it)
     {
-        retVal = retVal && p(tree->item());
-        retVal = retVal && prefix_process<T, Processor>(tree->left(), p);
-        retVal = retVal && prefix_process<T, Processor>(tree->right(), p);
+        retVal = p(*it);
     }
 
     return retVal;
@@ -107,18 +455,17 @@ prefix_process(typename BTree<T>::Ref tree, Processor& p)
  * @return true if all nodes were processed.
  * @pre tree!=nullptr
  */
-template <class T, class Processor>
+template <class T, class Augment, class Processor>
 bool
-infix_process(typename BTree<T>::Ref tree, Processor& p)
+infix_process(std::shared_ptr< BTree<T, Augment> > tree, Processor& p)
 {
     assert(tree != nullptr);
     bool retVal = true;
 
-    if(!tree->is_empty())
+    auto items = tree->infix();
+    for (auto it = items.begin(); retVal && it != items.end(); ++it)
     {
-        retVal = retVal && infix_process<T, Processor>(tree->left(), p);
-        retVal = retVal && p(tree->item());
-        retVal = retVal && infix_process<T, Processor>(tree->right(), p);
+        retVal = p(*it);
     }
 
     return retVal;
@@ -138,24 +485,227 @@ infix_process(typename BTree<T>::Ref tree, Processor& p)
  * @return true if all nodes were processed.
  * @pre tree!=nullptr
  */
-template <class T, class Processor>
+template <class T, class Augment, class Processor>
 bool
-postfix_process(typename BTree<T>::Ref tree, Processor& p)
+postfix_process(std::shared_ptr< BTree<T, Augment> > tree, Processor& p)
 {
     assert(tree != nullptr);
     bool retVal = true;
 
-    if(!tree->is_empty())
+    auto items = tree->postfix();
+    for (auto it = items.begin(); retVal && it != items.end(); ++it)
     {
-        retVal = retVal && postfix_process<T, Processor>(tree->left(), p);
-        retVal = retVal && postfix_process<T, Processor>(tree->right(), p);
-        retVal = retVal && p(tree->item());
+        retVal = p(*it);
     }
 
     return retVal;
 }
 
 
+/**
+ * @brief A FIFO queue of node pointers kept in a ring buffer.
+ * The buffer grows doubling its capacity and clear() keeps it, so a queue
+ * reused for several traversals stops allocating once it has room for the
+ * widest level.
+ */
+template <class T, class Node = BTNode<T> >
+class BTNodeRing
+{
+public:
+
+    typedef Node const* value_type;
+
+    BTNodeRing()
+        : head_(0), size_(0)
+    {}
+
+    /** @brief Is the queue empty?*/
+    bool is_empty() const
+    {
+        return size_ == 0;
+    }
+
+    /** @brief Number of queued nodes.*/
+    size_t size() const
+    {
+        return size_;
+    }
+
+    /** @brief Number of nodes that can be queued without allocating.*/
+    size_t capacity() const
+    {
+        return buffer_.size();
+    }
+
+    /**
+     * @brief The i-th queued node, 0 being the front one.
+     * @pre i < size()
+     */
+    value_type operator[](size_t i) const
+    {
+        assert(i < size_);
+        return buffer_[(head_ + i) & (buffer_.size() - 1)];
+    }
+
+    /** @brief Queue a node at the back.*/
+    void push_back(value_type node)
+    {
+        if (size_ == buffer_.size())
+            grow();
+        buffer_[(head_ + size_) & (buffer_.size() - 1)] = node;
+        ++size_;
+    }
+
+    /**
+     * @brief Dequeue the front node.
+     * @pre !is_empty()
+     */
+    value_type pop_front()
+    {
+        assert(!is_empty());
+        value_type node = buffer_[head_];
+        head_ = (head_ + 1) & (buffer_.size() - 1);
+        --size_;
+        return node;
+    }
+
+    /** @brief Empty the queue keeping its capacity.*/
+    void clear()
+    {
+        head_ = 0;
+        size_ = 0;
+    }
+
+protected:
+
+    /** @brief Double the capacity, which is always a power of two.*/
+    void grow()
+    {
+        std::vector<value_type> bigger (std::max<size_t>(16, 2 * buffer_.size()));
+        for (size_t i = 0; i < size_; ++i)
+            bigger[i] = (*this)[i];
+        buffer_.swap(bigger);
+        head_ = 0;
+    }
+
+    std::vector<value_type> buffer_;
+    size_t head_;
+    size_t size_;
+};
+
+/**
+ * @brief Level by level processing of a btree.
+ * The template class Processor must have an apply interface:
+ *
+ * bool Processor::operator()(size_t depth, BTNodeRing<T, Node> const& level).
+ *
+ * that is called once for each level, from the root one at depth 0, when
+ * level holds the nodes at that depth from left to right, Node being the
+ * type of the tree's nodes, and returns true
+ * when the processing must continue or false to stop it.
+ *
+ * A lambda expression can be used too.
+ *
+ * @param queue is the queue used to traverse the tree, which is cleared
+ *        first, so it can be reused by several traversals.
+ * @return true if all levels were processed.
+ * @pre tree!=nullptr
+ */
+template <class T, class Augment, class Processor>
+bool
+level_by_level_process(std::shared_ptr< BTree<T, Augment> > const& tree,
+                       Processor& p, BTNodeRing<T, BTNode<T, Augment> >& queue)
+{
+    assert(tree != nullptr);
+    bool retVal = true;
+
+    queue.clear();
+    if (!tree->is_empty())
+    {
+        queue.push_back(tree->root().get());
+    }
+    for (size_t depth = 0; retVal && !queue.is_empty(); ++depth)
+    {
+        retVal = p(depth,
+                   static_cast<BTNodeRing<T, BTNode<T, Augment> > const&>(queue));
+        for (size_t width = queue.size(); retVal && width > 0; --width)
+        {
+            BTNode<T, Augment> const* node = queue.pop_front();
+            if (node->has_left())
+            {
+                queue.push_back(node->left().get());
+            }
+            if (node->has_right())
+            {
+                queue.push_back(node->right().get());
+            }
+        }
+    }
+
+    return retVal;
+}
+
+/**
+ * @brief Level by level processing of a btree with its own queue.
+ * @see level_by_level_process(tree, p, queue).
+ */
+template <class T, class Augment, class Processor>
+bool
+level_by_level_process(std::shared_ptr< BTree<T, Augment> > const& tree,
+                       Processor& p)
+{
+    BTNodeRing<T, BTNode<T, Augment> > queue;
+    return level_by_level_process<T>(tree, p, queue);
+}
+
+/**
+ * @brief Bread-first processing of a btree giving the depth of each item.
+ * The template class Processor must have an apply interface:
+ *
+ * bool Processor::operator()(T const& item, size_t depth).
+ *
+ * that makes something with item, being depth 0 for the root, and returning
+ * true when the processing must continue or false to stop it.
+ *
+ * A lambda expression can be used too.
+ *
+ * @param queue is the queue used to traverse the tree, which is cleared
+ *        first, so it can be reused by several traversals.
+ * @return true if all nodes were processed.
+ * @pre tree!=nullptr
+ */
+template <class T, class Augment, class Processor>
+bool
+level_order_process(std::shared_ptr< BTree<T, Augment> > const& tree,
+                    Processor& p, BTNodeRing<T, BTNode<T, Augment> >& queue)
+{
+    auto items = [&p](size_t depth,
+                      BTNodeRing<T, BTNode<T, Augment> > const& level)
+    {
+        bool retVal = true;
+        for (size_t i = 0; retVal && i < level.size(); ++i)
+        {
+            retVal = p(level[i]->item(), depth);
+        }
+        return retVal;
+    };
+    return level_by_level_process<T>(tree, items, queue);
+}
+
+/**
+ * @brief Bread-first processing of a btree giving the depth of each item,
+ * with its own queue.
+ * @see level_order_process(tree, p, queue).
+ */
+template <class T, class Augment, class Processor>
+bool
+level_order_process(std::shared_ptr< BTree<T, Augment> > const& tree,
+                    Processor& p)
+{
+    BTNodeRing<T, BTNode<T, Augment> > queue;
+    return level_order_process<T>(tree, p, queue);
+}
+
 /**
  * @brief Bread-first processing of a btree.
  * The template class Processor must have an apply interface:
@@ -167,33 +717,51 @@ postfix_process(typename BTree<T>::Ref tree, Processor& p)
  *
  * A lambda expression can be used too.
  *
+ * @param queue is the queue used to traverse the tree, which is cleared
+ *        first, so it can be reused by several traversals.
  * @return true if all nodes were processed.
  * @pre tree!=nullptr
  */
-template <class T, class Processor>
+template <class T, class Augment, class Processor>
 bool
-breadth_first_process(typename BTree<T>::Ref tree, Processor& p)
+breadth_first_process(std::shared_ptr< BTree<T, Augment> > tree, Processor& p,
+                      BTNodeRing<T, BTNode<T, Augment> >& queue)
 {
     assert(tree != nullptr);
-    bool ret_val = true;
-
-    typename BTree<T>::Ref subtree;
-    std::queue<typename BTree<T>::Ref> trees;
-    trees.push(tree);
+    bool retVal = true;
 
-    while (!trees.empty() && ret_val)
+    queue.clear();
+    if (!tree->is_empty())
+    {
+        queue.push_back(tree->root().get());
+    }
+    while (retVal && !queue.is_empty())
     {
-        subtree = trees.front();
-        if(!subtree->is_empty())
+        BTNode<T, Augment> const* node = queue.pop_front();
+        retVal = p(node->item());
+        if (node->has_left())
+        {
+            queue.push_back(node->left().get());
+        }
+        if (node->has_right())
         {
-            ret_val = p(subtree->item());
-            trees.push(subtree->left());
-            trees.push(subtree->right());
+            queue.push_back(node->right().get());
         }
-        trees.pop();
     }
 
-    return ret_val;
+    return retVal;
+}
+
+/**
+ * @brief Bread-first processing of a btree.
+ * @see breadth_first_process(tree, p, queue).
+ */
+template <class T, class Augment, class Processor>
+bool
+breadth_first_process(std::shared_ptr< BTree<T, Augment> > tree, Processor& p)
+{
+    BTNodeRing<T, BTNode<T, Augment> > queue;
+    return breadth_first_process<T>(tree, p, queue);
 }
 
 /**
@@ -202,49 +770,97 @@ breadth_first_process(typename BTree<T>::Ref tree, Processor& p)
  * when for each subtree, the root node is greater than all its proper left
  * descendants and less than all its proper right descendants.
  *
+ * This is the same as its items being strictly increasing in infix order,
+ * so the tree is checked in a single pass comparing each item with the
+ * previous one.
+ *
  * @param tree is the tree to be checked.
  * @return true if the input tree is in order.
  */
-template<class T>
-bool check_btree_in_order(typename BTree<T>::Ref const& tree)
+template<class T, class Augment>
+bool check_btree_in_order(std::shared_ptr< BTree<T, Augment> > const& tree)
 {
     bool ret_val = true;
 
-    if(!tree->is_empty())
+    T const* previous = nullptr;
+    auto items = tree->infix();
+    for (auto it = items.begin(); ret_val && it != items.end(); ++it)
     {
-        if(!tree->right()->is_empty())
-        {
-            auto minRight = tree->right();
-            while (!minRight->left()->is_empty())
-            {
-                minRight = minRight->left();
-            }
-            if(minRight->item()<= tree->item())
-            {
-                ret_val=false;
-            }
-        }
-        if(!tree->left()->is_empty())
-        {
-            auto maxleft = tree->left();
-            while (!maxleft->right()->is_empty())
-            {
-                maxleft = maxleft->right();
-            }
-            if(maxleft->item()>= tree->item())
-            {
-                ret_val=false;
-            }
-        }
-        if(!check_btree_in_order<T>(tree->left()) || !check_btree_in_order<T>(tree->right()))
-        {
-            ret_val = false;
-        }
+        ret_val = previous == nullptr || *previous < *it;
+        previous = &*it;
     }
 
     return ret_val;
 }
 
+/**
+ * @brief How the in order precondition is checked in the debug builds.
+ *
+ * 0: it is not checked.
+ * 1: the nodes visited by has_in_order and insert_in_order are checked
+ *    against the bounds set by their ancestors, so the check takes
+ *    O(height) and the operations keep their cost. This is the default.
+ * 2: the visited nodes are checked and, besides, the whole tree is checked
+ *    once each __BTREE_ORDER_CHECK_PERIOD__ operations.
+ * 3: the visited nodes and the whole tree are checked in each operation,
+ *    which makes each operation O(n).
+ */
+#ifndef __BTREE_ORDER_CHECK__
+#define __BTREE_ORDER_CHECK__ 1
+#endif
+
+#ifndef __BTREE_ORDER_CHECK_PERIOD__
+#define __BTREE_ORDER_CHECK_PERIOD__ 1024
+#endif
+
+/**
+ * @brief Check the whole tree is in order as __BTREE_ORDER_CHECK__ says.
+ * @return false if the tree was checked and it is not in order.
+ */
+template<class T, class Augment>
+bool sampled_check_btree_in_order(std::shared_ptr< BTree<T, Augment> > const& tree)
+{
+#if __BTREE_ORDER_CHECK__ >= 3
+    return check_btree_in_order<T>(tree);
+#elif __BTREE_ORDER_CHECK__ == 2
+    static std::atomic<size_t> n_calls (0);
+    return ++n_calls % __BTREE_ORDER_CHECK_PERIOD__ != 0
+            || check_btree_in_order<T>(tree);
+#else
+    (void)tree;
+    return true;
+#endif
+}
+
+/**
+ * @brief The open interval of items allowed in a subtree of an in order
+ * tree, given by the ancestors visited while descending to it.
+ */
+template<class T>
+struct BTreeOrderBounds
+{
+    /** @brief The greatest ancestor less than the subtree, or nullptr.*/
+    T const* lower;
+    /** @brief The least ancestor greater than the subtree, or nullptr.*/
+    T const* upper;
+
+    BTreeOrderBounds()
+        : lower(nullptr), upper(nullptr)
+    {}
+
+    /** @brief Is item into the interval?*/
+    bool admits(T const& item) const
+    {
+#if __BTREE_ORDER_CHECK__ >= 1
+        return (lower == nullptr || *lower < item)
+                && (upper == nullptr || item < *upper);
+#else
+        (void)item;
+        return true;
+#endif
+    }
+};
+
 /**
  * @brief Search a item into the tree.
  *
@@ -255,21 +871,26 @@ bool check_btree_in_order(typename BTree<T>::Ref const& tree)
  * @pre check_btree_in_order(tree)
  * @return true if the value is in the tree.
  */
-template<class T>
-bool has_in_order(typename BTree<T>::Ref tree, T const& v)
+template<class T, class Augment>
+bool has_in_order(std::shared_ptr< BTree<T, Augment> > tree, T const& v)
 {
-    assert(check_btree_in_order<T>(tree));
+    assert(sampled_check_btree_in_order<T>(tree));
     bool ret_val = false;
 
-    if(!tree->is_empty())
+    BTreeOrderBounds<T> bounds;
+    BTNode<T, Augment> const* node = tree->root().get();
+    while (node != nullptr && !ret_val)
     {
-        if(v < tree->item())
+        assert(bounds.admits(node->item()));
+        if(v < node->item())
         {
-            ret_val=has_in_order(tree->left(), v);
+            bounds.upper = &node->item();
+            node = node->left().get();
         }
-        else if(v > tree->item())
+        else if(v > node->item())
         {
-            ret_val=has_in_order(tree->right(), v);
+            bounds.lower = &node->item();
+            node = node->right().get();
         }
         else
         {
@@ -288,43 +909,336 @@ bool has_in_order(typename BTree<T>::Ref tree, T const& v)
  * @param tree is the tree where inserting.
  * @param v is the value to be inserted.
  *
+ * When the nodes' augment policy updates the ancestors, the augment data of
+ * the nodes visited is updated from the bottom up if v was inserted.
+ *
  * @pre check_btree_in_order(tree)
  * @post has_in_order(tree, v)
  */
-template <class T>
-void insert_in_order(typename BTree<T>::Ref tree, T const& v)
+template <class T, class Augment>
+void insert_in_order(std::shared_ptr< BTree<T, Augment> > tree, T const& v)
 {
-    assert(check_btree_in_order<T>(tree));
+    assert(sampled_check_btree_in_order<T>(tree));
 
     if(tree->is_empty())
     {
         tree->create_root(v);
     }
-    else if (v < tree->item())
+    else
+    {
+        BTreeOrderBounds<T> bounds;
+        std::vector<BTNode<T, Augment>*> path;
+        if (Augment::updates)
+        {
+            path.reserve(64);
+        }
+        bool inserted = false;
+        BTNode<T, Augment>* node = tree->root().get();
+        while (node != nullptr)
+        {
+            assert(bounds.admits(node->item()));
+            if (Augment::updates)
+            {
+                path.push_back(node);
+            }
+            BTNode<T, Augment>* next = nullptr;
+            if (v < node->item())
+            {
+                bounds.upper = &node->item();
+                next = node->left().get();
+                if (next == nullptr)
+                {
+                    node->set_left(BTNode<T, Augment>::create(v));
+                    inserted = true;
+                }
+            }
+            else if (v > node->item())
+            {
+                bounds.lower = &node->item();
+                next = node->right().get();
+                if (next == nullptr)
+                {
+                    node->set_right(BTNode<T, Augment>::create(v));
+                    inserted = true;
+                }
+            }
+            node = next;
+        }
+        //The parent of the new node was updated when linking it.
+        if (inserted && path.size() > 1)
+        {
+            for (size_t i = path.size() - 1; i-- > 0;)
+            {
+                path[i]->update_augment();
+            }
+        }
+    }
+    assert(has_in_order<T>(tree, v));
+}
+
+/**
+ * @brief Count the items of an in order tree less than a value.
+ *
+ * The nodes must keep the size of their subtrees, as the ones with
+ * BTSizeHeightAugment do, so it takes O(height).
+ *
+ * @param tree is a in order binary tree.
+ * @param v is the value.
+ * @return the number of items less than v, that is the position v has, or
+ *         would have, in infix order.
+ * @pre check_btree_in_order(tree)
+ */
+template <class T, class Augment>
+size_t rank_in_order(std::shared_ptr< BTree<T, Augment> > const& tree,
+                     T const& v)
+{
+    assert(sampled_check_btree_in_order<T>(tree));
+    size_t ret_val = 0;
+
+    BTNode<T, Augment> const* node = tree->root().get();
+    while (node != nullptr)
     {
-        if(tree->left()->is_empty())
+        if (v < node->item())
         {
-            tree->set_left(BTree<T>::create(v));
+            node = node->left().get();
         }
         else
         {
-            insert_in_order(tree->left(),v);
+            ret_val += node->has_left() ? node->left()->size() : 0;
+            if (v > node->item())
+            {
+                ++ret_val;
+                node = node->right().get();
+            }
+            else
+            {
+                node = nullptr;
+            }
         }
     }
-    else if (v > tree->item())
+
+    return ret_val;
+}
+
+/**
+ * @brief Get the item of an in order tree at a position in infix order.
+ *
+ * The nodes must keep the size of their subtrees, as the ones with
+ * BTSizeHeightAugment do, so it takes O(height).
+ *
+ * @param tree is a in order binary tree.
+ * @param k is the position, 0 for the least item.
+ * @return the item with k items less than it.
+ * @pre check_btree_in_order(tree)
+ * @pre k < compute_size(tree)
+ * @post rank_in_order(tree, ret_val) == k
+ */
+template <class T, class Augment>
+T const& select_in_order(std::shared_ptr< BTree<T, Augment> > const& tree,
+                         size_t k)
+{
+    assert(sampled_check_btree_in_order<T>(tree));
+    assert(!tree->is_empty() && k < tree->root()->size());
+
+    BTNode<T, Augment> const* node = tree->root().get();
+    for (;;)
     {
-        if(tree->right()->is_empty())
+        const size_t left = node->has_left() ? node->left()->size() : 0;
+        if (k < left)
         {
-            tree->set_right(BTree<T>::create(v));
+            node = node->left().get();
+        }
+        else if (k > left)
+        {
+            k -= left + 1;
+            node = node->right().get();
         }
         else
         {
-            insert_in_order(tree->right(),v);
+            break;
         }
     }
-    assert(has_in_order<T>(tree, v));
+
+    return node->item();
 }
 
+/**
+ * @brief Sort a vector using several threads.
+ *
+ * The vector is split into chunks sorted concurrently, which are merged in
+ * pairs, the merges of each round being concurrent too.
+ *
+ * @param items is the vector to sort.
+ * @param n_threads is the number of threads, 0 means one for each hardware
+ *        thread.
+ * @param min_chunk_size is the minimum size of a chunk, so small inputs use
+ *        less threads.
+ * @post std::is_sorted(items.begin(), items.end())
+ */
+template <class T>
+void parallel_sort(std::vector<T>& items, unsigned n_threads = 0,
+                   size_t min_chunk_size = 1 << 15)
+{
+    if (n_threads == 0)
+        n_threads = std::max(1u, std::thread::hardware_concurrency());
+    if (min_chunk_size == 0)
+        min_chunk_size = 1;
+    const size_t n_chunks = std::max<size_t>(1, std::min<size_t>(
+                                                 n_threads, items.size() / min_chunk_size));
+    std::vector<size_t> bounds;
+    for (size_t i = 0; i <= n_chunks; ++i)
+        bounds.push_back(items.size() * i / n_chunks);
+
+    //Run task(i) for i in [0, n) with a thread for each one but the last.
+    //The workers are joined on every path and the first exception thrown
+    //by a task is rethrown after that.
+    auto run_tasks = [](size_t n, std::function<void(size_t)> task)
+    {
+        std::vector<std::exception_ptr> errors (n);
+        std::vector<std::thread> workers;
+        try
+        {
+            for (size_t i = 0; i + 1 < n; ++i)
+                workers.emplace_back([&task, &errors, i]()
+                {
+                    try
+                    {
+                        task(i);
+                    }
+                    catch (...)
+                    {
+                        errors[i] = std::current_exception();
+                    }
+                });
+            if (n > 0)
+                task(n - 1);
+        }
+        catch (...)
+        {
+            for (auto& worker : workers)
+                worker.join();
+            throw;
+        }
+        for (auto& worker : workers)
+            worker.join();
+        for (auto const& error : errors)
+            if (error)
+                std::rethrow_exception(error);
+    };
+
+    run_tasks(n_chunks, [&](size_t i)
+    {
+        std::sort(items.begin() + bounds[i], items.begin() + bounds[i + 1]);
+    });
+    for (size_t width = 1; width < n_chunks; width *= 2)
+    {
+        run_tasks((n_chunks + 2 * width - 1) / (2 * width), [&](size_t i)
+        {
+            const size_t first = 2 * width * i;
+            const size_t middle = std::min(first + width, n_chunks);
+            const size_t last = std::min(first + 2 * width, n_chunks);
+            std::inplace_merge(items.begin() + bounds[first],
+                               items.begin() + bounds[middle],
+                               items.begin() + bounds[last]);
+        });
+    }
+}
+
+/**
+ * @brief Build a balanced tree with the sorted items [first, last).
+ * The middle item is the root and the two halves are built recursively, the
+ * left half in a new thread while there are threads left.
+ * @return the root node.
+ */
+template <class T>
+typename BTNode<T>::Ref build_balanced_nodes(T const* first, T const* last,
+                                             unsigned n_threads,
+                                             size_t min_parallel_size)
+{
+    typename BTNode<T>::Ref node;
+    if (first < last)
+    {
+        T const* middle = first + (last - first) / 2;
+        typename BTNode<T>::Ref left;
+        typename BTNode<T>::Ref right;
+        if (n_threads > 1 && size_t(last - first) >= min_parallel_size)
+        {
+            const unsigned left_threads = n_threads / 2;
+            std::exception_ptr left_error;
+            std::thread worker ([&]()
+            {
+                try
+                {
+                    left = build_balanced_nodes(first, middle, left_threads,
+                                                min_parallel_size);
+                }
+                catch (...)
+                {
+                    left_error = std::current_exception();
+                }
+            });
+            try
+            {
+                right = build_balanced_nodes(middle + 1, last,
+                                             n_threads - left_threads,
+                                             min_parallel_size);
+            }
+            catch (...)
+            {
+                worker.join();
+                throw;
+            }
+            worker.join();
+            if (left_error)
+                std::rethrow_exception(left_error);
+        }
+        else
+        {
+            left = build_balanced_nodes(first, middle, 1u, min_parallel_size);
+            right = build_balanced_nodes(middle + 1, last, 1u, min_parallel_size);
+        }
+        node = BTNode<T>::create(*middle, std::move(left), std::move(right));
+    }
+    return node;
+}
+
+/**
+ * @brief Build a balanced in order tree with the items [first, last).
+ *
+ * The items are sorted, the repeated ones are removed, as insert_in_order
+ * does, and the tree is built in O(n) taking the middle item as the root of
+ * each subtree, so its height is the least possible one.
+ *
+ * @param first,
+ * @param last specify the items, in any order.
+ * @param n_threads is the number of threads used to sort and build, 0 means
+ *        one for each hardware thread.
+ * @param min_parallel_size is the minimum number of items handled by a
+ *        thread, so small inputs use less threads.
+ * @return a reference to the new tree.
+ * @post check_btree_in_order(ret_val)
+ */
+template <class T, class Iterator>
+typename BTree<T>::Ref build_balanced_bst(Iterator first, Iterator last,
+                                          unsigned n_threads = 1,
+                                          size_t min_parallel_size = 1 << 15)
+{
+    if (n_threads == 0)
+        n_threads = std::max(1u, std::thread::hardware_concurrency());
+    std::vector<T> items (first, last);
+    parallel_sort(items, n_threads, min_parallel_size);
+    items.erase(std::unique(items.begin(), items.end(),
+                            [](T const& a, T const& b) { return !(a < b); }),
+                items.end());
+
+    auto tree = BTree<T>::create();
+    if (!items.empty())
+        tree->set_root(build_balanced_nodes(items.data(),
+                                            items.data() + items.size(),
+                                            n_threads, min_parallel_size));
+    assert(sampled_check_btree_in_order<T>(tree));
+    return tree;
+}
 
 
 #endif
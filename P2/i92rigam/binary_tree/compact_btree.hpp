@@ -0,0 +1,505 @@
+#ifndef __ED_CompactBTree_HPP__
+#define __ED_CompactBTree_HPP__
+
+#include <algorithm>
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <iostream>
+#include <memory>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+#include "btree.hpp"
+
+/** @brief Order of the nodes into a CompactBTree.*/
+enum class CompactLayout
+{
+    /** @brief The nodes are stored in prefix order.*/
+    PREORDER,
+    /**
+     * @brief van Emde Boas order.
+     * The top half of the levels is stored first, followed by each subtree
+     * hanging from it, all of them laid out in the same way recursively. A
+     * root to leaf path of h levels touches O(log_B h) cache lines of B nodes.
+     */
+    VAN_EMDE_BOAS
+};
+
+/**
+ * @brief A read only binary tree stored in a contiguous arena.
+ *
+ * The nodes are kept in a vector and linked with 32 bit indices, so a node
+ * of int only takes 12 bytes and a traversal walks a single block of memory,
+ * while a BTNode needs two shared_ptr and its own heap block with a control
+ * block. In every layout a node is stored before its descendants, so the
+ * root is the node 0.
+ *
+ * Use it for trees that are built once and read many times, converting
+ * them from and to a BTree.
+ */
+template <class T>
+class CompactBTree
+{
+public:
+
+    /** @brief Define a shared reference to a CompactBTree.*/
+    typedef std::shared_ptr< CompactBTree<T> > Ref;
+
+    /** @brief Position of a node into the arena.*/
+    typedef std::uint32_t Index;
+
+    /** @brief The index of a missing child.*/
+    static constexpr Index NIL = UINT32_MAX;
+
+    /** @brief A node of the arena.*/
+    struct Node
+    {
+        T item;
+        Index left;
+        Index right;
+    };
+
+    /** @name Life cicle.*/
+    /** @{*/
+
+    /**
+     * @brief Create an empty tree.
+     * @post is_empty()
+     */
+    CompactBTree()
+        : layout_(CompactLayout::PREORDER)
+    {}
+
+    /**
+     * @brief Create a compact copy of a tree.
+     * @param tree is the tree to copy.
+     * @param layout is the order of the nodes into the arena.
+     * @return a shared reference to the new tree.
+     * @pre tree!=nullptr
+     * @warning throw std::runtime_error("Tree too large.") if the tree has
+     * more nodes than the indices can address.
+     */
+    static typename CompactBTree<T>::Ref
+    create(typename BTree<T>::Ref const& tree,
+           CompactLayout layout = CompactLayout::PREORDER) noexcept(false)
+    {
+        assert(tree != nullptr);
+        auto compact = std::make_shared< CompactBTree<T> >();
+        compact->copy_preorder(tree->root().get());
+        if (layout == CompactLayout::VAN_EMDE_BOAS)
+            compact->relayout_veb();
+        compact->layout_ = layout;
+        return compact;
+    }
+
+    /**
+     * @brief Create a BTree with the same shape and items.
+     * @return a reference to the new tree.
+     */
+    typename BTree<T>::Ref to_btree() const
+    {
+        auto tree = BTree<T>::create();
+        if (!is_empty())
+        {
+            //Children are stored after their parent, so walking the arena
+            //backwards creates the subtrees before they are linked.
+            std::vector< typename BTNode<T>::Ref > subtrees (nodes_.size());
+            for (size_t i = nodes_.size() - 1; i > 0; --i)
+                subtrees[i] = BTNode<T>::create(nodes_[i].item,
+                                                take(subtrees, nodes_[i].left),
+                                                take(subtrees, nodes_[i].right));
+            tree->create_root(nodes_[0].item);
+            tree->root()->set_left(take(subtrees, nodes_[0].left));
+            tree->root()->set_right(take(subtrees, nodes_[0].right));
+        }
+        return tree;
+    }
+
+    /** @}*/
+
+    /** @name Observers*/
+    /** @{*/
+
+    /** @brief is the tree empty?.*/
+    bool is_empty() const
+    {
+        return nodes_.empty();
+    }
+
+    /** @brief Number of nodes.*/
+    size_t size() const
+    {
+        return nodes_.size();
+    }
+
+    /** @brief Order of the nodes into the arena.*/
+    CompactLayout layout() const
+    {
+        return layout_;
+    }
+
+    /** @brief Index of the root node, NIL if the tree is empty.*/
+    Index root() const
+    {
+        return is_empty() ? NIL : 0;
+    }
+
+    /**
+     * @brief Get the item of a node.
+     * @pre i < size()
+     */
+    T const& item(Index i) const
+    {
+        assert(i < size());
+        return nodes_[i].item;
+    }
+
+    /**
+     * @brief Get the left child of a node.
+     * @return its index or NIL.
+     * @pre i < size()
+     */
+    Index left(Index i) const
+    {
+        assert(i < size());
+        return nodes_[i].left;
+    }
+
+    /**
+     * @brief Get the right child of a node.
+     * @return its index or NIL.
+     * @pre i < size()
+     */
+    Index right(Index i) const
+    {
+        assert(i < size());
+        return nodes_[i].right;
+    }
+
+    /** @brief The nodes in layout order.*/
+    std::vector<Node> const& nodes() const
+    {
+        return nodes_;
+    }
+
+    /** @brief Bytes used by the tree, without counting the items' own storage.*/
+    size_t memory() const
+    {
+        return sizeof(*this) + nodes_.capacity() * sizeof(Node);
+    }
+
+    /**
+     * @brief Fold the tree.
+     * The output format is the same as BTree::fold().
+     * @param out is the output stream.
+     * @return the output stream.
+     */
+    std::ostream& fold(std::ostream& out) const
+    {
+        //Pending pieces of output: a subtree to fold or a text to write.
+        struct Piece
+        {
+            Index node;
+            const char* text;
+        };
+        std::vector<Piece> pending;
+        pending.push_back(Piece{root(), nullptr});
+        while (!pending.empty())
+        {
+            const Piece piece = pending.back();
+            pending.pop_back();
+            if (piece.text != nullptr)
+            {
+                out << piece.text;
+            }
+            else if (piece.node == NIL)
+            {
+                out << "[]";
+            }
+            else
+            {
+                out << "[ " << nodes_[piece.node].item << " ";
+                pending.push_back(Piece{NIL, " ]"});
+                pending.push_back(Piece{nodes_[piece.node].right, nullptr});
+                pending.push_back(Piece{NIL, " "});
+                pending.push_back(Piece{nodes_[piece.node].left, nullptr});
+            }
+        }
+        return out;
+    }
+
+    /** @}*/
+
+protected:
+
+    /** @brief Move out the subtree of a child, nullptr if it is NIL.*/
+    static typename BTNode<T>::Ref
+    take(std::vector< typename BTNode<T>::Ref >& subtrees, Index child)
+    {
+        typename BTNode<T>::Ref subtree;
+        if (child != NIL)
+            subtree = std::move(subtrees[child]);
+        return subtree;
+    }
+
+    /** @brief Fill the arena with the nodes under root in prefix order.*/
+    void copy_preorder(BTNode<T> const* root) noexcept(false)
+    {
+        //Each pending node carries the link to set: 2*parent+side, where
+        //side is 1 for a right child, or SIZE_MAX for the root.
+        std::vector< std::pair<BTNode<T> const*, size_t> > pending;
+        if (root != nullptr)
+            pending.push_back(std::make_pair(root, SIZE_MAX));
+        while (!pending.empty())
+        {
+            const auto next = pending.back();
+            pending.pop_back();
+            if (nodes_.size() >= NIL)
+                throw std::runtime_error("Tree too large.");
+            const Index i = Index(nodes_.size());
+            nodes_.push_back(Node{next.first->item(), NIL, NIL});
+            if (next.second != SIZE_MAX)
+            {
+                Node& parent = nodes_[next.second / 2];
+                (next.second % 2 == 0 ? parent.left : parent.right) = i;
+            }
+            if (next.first->right() != nullptr)
+                pending.push_back(std::make_pair(next.first->right().get(),
+                                                 2 * size_t(i) + 1));
+            if (next.first->left() != nullptr)
+                pending.push_back(std::make_pair(next.first->left().get(),
+                                                 2 * size_t(i)));
+        }
+        nodes_.shrink_to_fit();
+    }
+
+    /** @brief Reorder a prefix order arena in van Emde Boas order.*/
+    void relayout_veb()
+    {
+        if (is_empty())
+            return;
+
+        //Levels of the subtree under each node, children come after parents.
+        std::vector<Index> levels (nodes_.size());
+        for (size_t i = nodes_.size(); i-- > 0;)
+        {
+            const Node& node = nodes_[i];
+            const Index l = node.left == NIL ? 0 : levels[node.left];
+            const Index r = node.right == NIL ? 0 : levels[node.right];
+            levels[i] = 1 + std::max(l, r);
+        }
+
+        std::vector<Index> order;
+        order.reserve(nodes_.size());
+        std::vector<Index> frontier;
+        std::vector< std::pair<Index, Index> > stack;
+        veb_order(0, levels[0], levels, order, frontier, stack);
+        assert(order.size() == nodes_.size());
+
+        std::vector<Index> position (nodes_.size());
+        for (size_t k = 0; k < order.size(); ++k)
+            position[order[k]] = Index(k);
+        std::vector<Node> reordered;
+        reordered.reserve(nodes_.size());
+        for (Index old : order)
+        {
+            Node& node = nodes_[old];
+            reordered.push_back(Node{std::move(node.item),
+                                     node.left == NIL ? NIL : position[node.left],
+                                     node.right == NIL ? NIL : position[node.right]});
+        }
+        nodes_.swap(reordered);
+    }
+
+    /**
+     * @brief Append to order the van Emde Boas order of the first n_levels
+     * levels under root.
+     * The recursion depth is O(log height). frontier and stack are scratch
+     * vectors shared by all the calls.
+     */
+    void veb_order(Index root, Index n_levels, std::vector<Index> const& levels,
+                   std::vector<Index>& order, std::vector<Index>& frontier,
+                   std::vector< std::pair<Index, Index> >& stack) const
+    {
+        n_levels = std::min(n_levels, levels[root]);
+        if (n_levels == 1)
+        {
+            order.push_back(root);
+            return;
+        }
+        const Index top = n_levels / 2;
+        veb_order(root, top, levels, order, frontier, stack);
+
+        //Collect, left to right, the roots of the subtrees below the top part.
+        const size_t first = frontier.size();
+        stack.push_back(std::make_pair(root, Index(0)));
+        while (!stack.empty())
+        {
+            const auto next = stack.back();
+            stack.pop_back();
+            if (next.second == top)
+            {
+                frontier.push_back(next.first);
+            }
+            else
+            {
+                const Node& node = nodes_[next.first];
+                if (node.right != NIL)
+                    stack.push_back(std::make_pair(node.right, next.second + 1));
+                if (node.left != NIL)
+                    stack.push_back(std::make_pair(node.left, next.second + 1));
+            }
+        }
+        const size_t last = frontier.size();
+        for (size_t k = first; k < last; ++k)
+            veb_order(frontier[k], n_levels - top, levels, order, frontier, stack);
+        frontier.resize(first);
+    }
+
+    std::vector<Node> nodes_;
+    CompactLayout layout_;
+};
+
+template <class T>
+constexpr typename CompactBTree<T>::Index CompactBTree<T>::NIL;
+
+/**
+ * @brief Prefix processing of a compact tree.
+ * Processor has the same interface as for prefix_process(BTree).
+ * With the preorder layout this is a sequential scan of the arena.
+ * @return true if all nodes were processed.
+ */
+template <class T, typename Processor>
+bool
+prefix_process(CompactBTree<T> const& tree, Processor& p)
+{
+    typedef typename CompactBTree<T>::Index Index;
+    auto const& nodes = tree.nodes();
+    bool retVal = true;
+    if (tree.layout() == CompactLayout::PREORDER)
+    {
+        for (size_t i = 0; retVal && i < nodes.size(); ++i)
+            retVal = p(nodes[i].item);
+        return retVal;
+    }
+
+    std::vector<Index> pending;
+    if (!tree.is_empty())
+        pending.push_back(tree.root());
+    while (retVal && !pending.empty())
+    {
+        auto const& node = nodes[pending.back()];
+        pending.pop_back();
+        retVal = p(node.item);
+        if (node.right != CompactBTree<T>::NIL)
+            pending.push_back(node.right);
+        if (node.left != CompactBTree<T>::NIL)
+            pending.push_back(node.left);
+    }
+    return retVal;
+}
+
+/**
+ * @brief Infix processing of a compact tree.
+ * Processor has the same interface as for infix_process(BTree).
+ * @return true if all nodes were processed.
+ */
+template <class T, typename Processor>
+bool
+infix_process(CompactBTree<T> const& tree, Processor& p)
+{
+    typedef typename CompactBTree<T>::Index Index;
+    auto const& nodes = tree.nodes();
+    bool retVal = true;
+    std::vector<Index> pending;
+    Index next = tree.root();
+    while (retVal && (next != CompactBTree<T>::NIL || !pending.empty()))
+    {
+        if (next != CompactBTree<T>::NIL)
+        {
+            pending.push_back(next);
+            next = nodes[next].left;
+        }
+        else
+        {
+            auto const& node = nodes[pending.back()];
+            pending.pop_back();
+            retVal = p(node.item);
+            next = node.right;
+        }
+    }
+    return retVal;
+}
+
+/**
+ * @brief Postfix processing of a compact tree.
+ * Processor has the same interface as for postfix_process(BTree).
+ * @return true if all nodes were processed.
+ */
+template <class T, typename Processor>
+bool
+postfix_process(CompactBTree<T> const& tree, Processor& p)
+{
+    typedef typename CompactBTree<T>::Index Index;
+    auto const& nodes = tree.nodes();
+    bool retVal = true;
+    std::vector<Index> pending;
+    Index next = tree.root();
+    Index last = CompactBTree<T>::NIL;
+    while (retVal && (next != CompactBTree<T>::NIL || !pending.empty()))
+    {
+        if (next != CompactBTree<T>::NIL)
+        {
+            pending.push_back(next);
+            next = nodes[next].left;
+        }
+        else
+        {
+            const Index top = pending.back();
+            const Index right = nodes[top].right;
+            if (right != CompactBTree<T>::NIL && right != last)
+            {
+                next = right;
+            }
+            else
+            {
+                pending.pop_back();
+                retVal = p(nodes[top].item);
+                last = top;
+            }
+        }
+    }
+    return retVal;
+}
+
+/**
+ * @brief Breadth first processing of a compact tree.
+ * Processor has the same interface as for breadth_first_process(BTree).
+ * @return true if all nodes were processed.
+ */
+template <class T, typename Processor>
+bool
+breadth_first_process(CompactBTree<T> const& tree, Processor& p)
+{
+    typedef typename CompactBTree<T>::Index Index;
+    auto const& nodes = tree.nodes();
+    bool retVal = true;
+    std::vector<Index> queue;
+    queue.reserve(tree.size());
+    if (!tree.is_empty())
+        queue.push_back(tree.root());
+    for (size_t head = 0; retVal && head < queue.size(); ++head)
+    {
+        auto const& node = nodes[queue[head]];
+        retVal = p(node.item);
+        if (node.left != CompactBTree<T>::NIL)
+            queue.push_back(node.left);
+        if (node.right != CompactBTree<T>::NIL)
+            queue.push_back(node.right);
+    }
+    return retVal;
+}
+
+#endif //__ED_CompactBTree_HPP__
@@ -0,0 +1,98 @@
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <exception>
+#include <vector>
+
+#include "btree.hpp"
+#include "btree_image.hpp"
+
+void
+usage()
+{
+    std::cerr << "Usage: convert_btree --to-binary [--no-index] text_file image_file"
+              << std::endl;
+    std::cerr << "       convert_btree --to-text image_file text_file"
+              << std::endl;
+    std::cerr << "The trees have int items. --no-index writes the image"
+              << " without the right children indices." << std::endl;
+}
+
+int
+main(int argc, const char* argv[])
+{
+    int exit_code = EXIT_SUCCESS;
+    try
+    {
+        std::vector<std::string> args (argv + 1, argv + argc);
+        bool to_binary = false;
+        bool right_index = true;
+        if (!args.empty() && args[0] == "--to-binary")
+        {
+            to_binary = true;
+            args.erase(args.begin());
+            if (!args.empty() && args[0] == "--no-index")
+            {
+                right_index = false;
+                args.erase(args.begin());
+            }
+        }
+        else if (!args.empty() && args[0] == "--to-text")
+        {
+            args.erase(args.begin());
+        }
+        else
+        {
+            usage();
+            return EXIT_FAILURE;
+        }
+        if (args.size() != 2)
+        {
+            usage();
+            return EXIT_FAILURE;
+        }
+        //The input is loaded before the output is opened, so a bad input or
+        //an output path equal to the input path does not truncate a file.
+        //A mapped image is folded into memory first for the same reason.
+        BTree<int>::Ref tree;
+        std::string text;
+        if (to_binary)
+            tree = BTree<int>::load(args[0]);
+        else
+        {
+            std::ostringstream buffer;
+            BTreeImage<int>::load(args[0])->fold(buffer) << std::endl;
+            text = buffer.str();
+        }
+        std::ofstream output (args[1], std::ios::binary);
+        if (!output)
+        {
+            std::cerr << "Error: could not open output filename '" << args[1]
+                      << "'." << std::endl;
+            return EXIT_FAILURE;
+        }
+        if (to_binary)
+            BTreeImage<int>::save(tree, output, right_index);
+        else
+            output << text;
+        output.close();
+        if (!output)
+        {
+            std::cerr << "Error: could not write output filename '" << args[1]
+                      << "'." << std::endl;
+            exit_code = EXIT_FAILURE;
+        }
+    }
+    catch(std::runtime_error &e)
+    {
+        std::cerr << "Run time exception: " << e.what() << std::endl;
+        exit_code = EXIT_FAILURE;
+    }
+    catch(...)
+    {
+        std::cerr << "Catched unknown exception!." << std::endl;
+        exit_code = EXIT_FAILURE;
+    }
+    return exit_code;
+}
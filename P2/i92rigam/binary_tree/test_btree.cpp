@@ -3,9 +3,12 @@
 #include <sstream>
 #include <string>
 #include <exception>
+#include <vector>
 
 #include "btree.hpp"
 #include "btree_utils.hpp"
+#include "compact_btree.hpp"
+#include "btree_image.hpp"
 
 int
 main(int argc, const char* argv[])
@@ -28,6 +31,17 @@ main(int argc, const char* argv[])
         }
 
         auto tree = BTree<int>::create();
+        //A copy of the tree whose nodes keep their subtree size and height.
+        auto sized = BTree<int, BTSizeHeightAugment>::create();
+        //Print the cached size and height and the walked ones.
+        auto print_sized = [&sized]()
+        {
+            std::cout << "Sized tree size: " << compute_size<int>(sized)
+                      << ", height: " << compute_height<int>(sized)
+                      << " (walked " << parallel_compute_size<int>(sized, 1)
+                      << ", " << parallel_compute_height<int>(sized, 1)
+                      << ") ." << std::endl;
+        };
         std::string command;
         std::cout << std::unitbuf;
         while(input_file)
@@ -51,6 +65,85 @@ main(int argc, const char* argv[])
                     tree->fold(std::cout);
                     std::cout << std::endl;
                 }
+                else if (command == "COMPACT")
+                {
+                    std::string layout_name;
+                    input_file >> layout_name;
+                    CompactLayout layout = CompactLayout::PREORDER;
+                    if (layout_name == "VEB")
+                        layout = CompactLayout::VAN_EMDE_BOAS;
+                    else if (layout_name != "PREORDER")
+                    {
+                        std::cerr << "Error: input test file worng. "
+                                  << std::endl;
+                        return EXIT_FAILURE;
+                    }
+                    auto compact = CompactBTree<int>::create(tree, layout);
+                    std::cout << "Compacting (" << layout_name << ") ";
+                    compact->fold(std::cout);
+                    std::cout << std::endl;
+                    std::cout << "Compact layout: ";
+                    for (auto const& node : compact->nodes())
+                        std::cout << node.item << ' ';
+                    std::cout << std::endl;
+                    auto p = [](int v) mutable {std::cout << v << ' '; return true;};
+                    std::cout << "Compact prefix output: ";
+                    prefix_process<int>(*compact, p);
+                    std::cout << std::endl;
+                    std::cout << "Compact infix output: ";
+                    infix_process<int>(*compact, p);
+                    std::cout << std::endl;
+                    std::cout << "Compact postfix output: ";
+                    postfix_process<int>(*compact, p);
+                    std::cout << std::endl;
+                    std::cout << "Compact breath first output: ";
+                    breadth_first_process<int>(*compact, p);
+                    std::cout << std::endl;
+                    tree = compact->to_btree();
+                }
+                else if (command == "IMAGE")
+                {
+                    std::string index_name;
+                    input_file >> index_name;
+                    if (index_name != "INDEX" && index_name != "PLAIN")
+                    {
+                        std::cerr << "Error: input test file worng. "
+                                  << std::endl;
+                        return EXIT_FAILURE;
+                    }
+                    std::ostringstream out;
+                    BTreeImage<int>::save(tree, out, index_name == "INDEX");
+                    const std::string data = out.str();
+                    auto image = BTreeImage<int>::create(data.data(), data.size());
+                    std::cout << "Image (" << index_name << ") of "
+                              << data.size() << " bytes ";
+                    image->fold(std::cout);
+                    std::cout << std::endl;
+                    std::cout << "Image right children: ";
+                    for (size_t i = 0; i < image->size(); ++i)
+                    {
+                        const auto right = image->right(i);
+                        if (right == BTreeImage<int>::NIL)
+                            std::cout << "- ";
+                        else
+                            std::cout << right << ' ';
+                    }
+                    std::cout << std::endl;
+                    auto p = [](int v) mutable {std::cout << v << ' '; return true;};
+                    std::cout << "Image prefix output: ";
+                    prefix_process<int>(*image, p);
+                    std::cout << std::endl;
+                    std::cout << "Image infix output: ";
+                    infix_process<int>(*image, p);
+                    std::cout << std::endl;
+                    std::cout << "Image postfix output: ";
+                    postfix_process<int>(*image, p);
+                    std::cout << std::endl;
+                    std::cout << "Image breath first output: ";
+                    breadth_first_process<int>(*image, p);
+                    std::cout << std::endl;
+                    tree = image->to_btree();
+                }
                 else if (command == "ATTACH_LEFT")
                 {
                     std::cout << "Attaching a new left child..." << std::endl;
@@ -72,6 +165,23 @@ main(int argc, const char* argv[])
                               << compute_size<int>(tree)
                               << " ." << std::endl;
                 }
+                else if (command == "PARALLEL")
+                {
+                    unsigned n_threads = 0;
+                    input_file >> n_threads;
+                    const long sum = parallel_reduce<int>(
+                        tree, 0l, [](int v) { return long(v); },
+                        [](long item, long left, long right)
+                        {
+                            return item + left + right;
+                        },
+                        n_threads, 1);
+                    std::cout << "Parallel (" << n_threads << " threads) height: "
+                              << parallel_compute_height<int>(tree, n_threads, 1)
+                              << ", size: "
+                              << parallel_compute_size<int>(tree, n_threads, 1)
+                              << ", sum: " << sum << " ." << std::endl;
+                }
                 else if (command == "PRINT_PREFIX")
                 {
                     std::cout << "Prefix output: ";
@@ -100,6 +210,27 @@ main(int argc, const char* argv[])
                     breadth_first_process<int>(tree, p);
                     std::cout << std::endl;
                 }
+                else if (command == "PRINT_LEVELS")
+                {
+                    auto p = [](size_t depth, BTNodeRing<int> const& level) mutable
+                    {
+                        std::cout << "Level " << depth << " (" << level.size()
+                                  << " nodes): ";
+                        for (size_t i = 0; i < level.size(); ++i)
+                            std::cout << level[i]->item() << ' ';
+                        std::cout << std::endl;
+                        return true;
+                    };
+                    level_by_level_process<int>(tree, p);
+                    auto d = [](int v, size_t depth) mutable
+                    {
+                        std::cout << v << ':' << depth << ' ';
+                        return true;
+                    };
+                    std::cout << "Level order output: ";
+                    level_order_process<int>(tree, d);
+                    std::cout << std::endl;
+                }
                 else if (command == "PREFIX_SEARCH")
                 {
                     int v;
@@ -202,6 +333,99 @@ main(int argc, const char* argv[])
                     }
                     std::cout << '.' << std::endl;
                 }
+                else if (command == "SIZED")
+                {
+                    std::stringstream folded;
+                    tree->fold(folded);
+                    sized = BTree<int, BTSizeHeightAugment>::create(folded);
+                    std::cout << "Sizing ..." << std::endl;
+                    print_sized();
+                }
+                else if (command == "SIZED_INSERT")
+                {
+                    std::string line;
+                    std::getline(input_file, line);
+                    std::istringstream values (line);
+                    int v;
+                    std::cout << "Inserting in order in sized tree ";
+                    while (values >> v)
+                    {
+                        std::cout << v << ' ';
+                        insert_in_order<int>(sized, v);
+                    }
+                    std::cout << '.' << std::endl;
+                    print_sized();
+                }
+                else if (command == "SIZED_ATTACH_LEFT")
+                {
+                    std::cout << "Attaching a new left child to sized tree..."
+                              << std::endl;
+                    sized->set_left(BTree<int, BTSizeHeightAugment>::create(input_file));
+                    print_sized();
+                }
+                else if (command == "SIZED_ATTACH_RIGHT")
+                {
+                    std::cout << "Attaching a new right child to sized tree..."
+                              << std::endl;
+                    sized->set_right(BTree<int, BTSizeHeightAugment>::create(input_file));
+                    print_sized();
+                }
+                else if (command == "SIZED_REMOVE_LEFT")
+                {
+                    std::cout << "Removing the left child of sized tree..."
+                              << std::endl;
+                    sized->remove_left();
+                    print_sized();
+                }
+                else if (command == "SIZED_REMOVE_RIGHT")
+                {
+                    std::cout << "Removing the right child of sized tree..."
+                              << std::endl;
+                    sized->remove_right();
+                    print_sized();
+                }
+                else if (command == "RANK")
+                {
+                    int v;
+                    input_file >> v;
+                    if (!input_file)
+                    {
+                        std::cerr << "Error: input test file worng. "
+                                  << std::endl;
+                        return EXIT_FAILURE;
+                    }
+                    std::cout << "Rank of " << v << " in sized tree: "
+                              << rank_in_order<int>(sized, v) << " ." << std::endl;
+                }
+                else if (command == "SELECT")
+                {
+                    size_t k;
+                    input_file >> k;
+                    if (!input_file || k >= compute_size<int>(sized))
+                    {
+                        std::cerr << "Error: input test file worng. "
+                                  << std::endl;
+                        return EXIT_FAILURE;
+                    }
+                    std::cout << "Item " << k << " of sized tree: "
+                              << select_in_order<int>(sized, k) << " ." << std::endl;
+                }
+                else if (command == "BUILD_BALANCED")
+                {
+                    std::string line;
+                    std::getline(input_file, line);
+                    std::istringstream values (line);
+                    std::vector<int> items;
+                    int v;
+                    std::cout << "Building balanced ";
+                    while (values >> v)
+                    {
+                        std::cout << v << ' ';
+                        items.push_back(v);
+                    }
+                    std::cout << '.' << std::endl;
+                    tree = build_balanced_bst<int>(items.begin(), items.end());
+                }
                 else
                 {
                     std::cerr << "Error: unknown command '"<< command
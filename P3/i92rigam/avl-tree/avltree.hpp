@@ -9,10 +9,18 @@
 #include <functional>
 #include <vector>
 
+template <class T> class AVLTree;
+
 /**
  * @brief a AVLTree's Node.
  * Models a node of AVLTree.
+ * A node owns its children by shared references but the link to its parent
+ * is a raw non-owning pointer, so a tree never holds reference cycles and
+ * walking up it does not touch any reference count.
  * @invariant height = 1 + max{ left's height, right's height }
+ * @invariant size = 1 + left's size + right's size
+ * @invariant !has_left() || left()->parent() == this
+ * @invariant !has_right() || right()->parent() == this
 */
 template <class T>
 class AVLTNode
@@ -37,7 +45,7 @@ public:
      * @param right is a link to the right child node.
      * @return a shared reference to node created.
      */
-    AVLTNode (T const& it=T(), AVLTNode<T>::Ref parent=nullptr,
+    AVLTNode (T const& it=T(), AVLTNode<T>* parent=nullptr,
               AVLTNode<T>::Ref left=nullptr, AVLTNode<T>::Ref right=nullptr);
 
     /**
@@ -49,12 +57,14 @@ public:
      * @return a shared reference to node created.
      */
     static typename AVLTNode<T>::Ref create(T const& it=T(),
-                                            AVLTNode<T>::Ref parent=nullptr,
+                                            AVLTNode<T>* parent=nullptr,
                                             AVLTNode<T>::Ref left=nullptr,
                                             AVLTNode<T>::Ref right=nullptr);
-    /** @brief Destroy a AVLTNode. **/
-    ~AVLTNode()
-    {}
+    /**
+     * @brief Destroy a AVLTNode.
+     * The children that outlive this node are left without parent.
+     */
+    ~AVLTNode();
 
     /** @}*/
 
@@ -70,6 +80,12 @@ public:
      */
     int height() const;
 
+    /**
+     * @brief Get the number of nodes of the subtree rooted at this node.
+     * @post time analysis: O(1).
+     */
+    int size() const;
+
     /**
      * @brief Get the balance factor of the node.
      * @post time analysis: O(1).
@@ -79,20 +95,23 @@ public:
     /** @brief Has it a parent?*/
     bool has_parent() const;
 
-    /** @brief get the parent.*/
-    AVLTNode<T>::Ref parent() const;
+    /**
+     * @brief get the parent.
+     * @return a non-owning pointer to the parent or nullptr.
+     */
+    AVLTNode<T>* parent() const;
 
     /** @brief Has it a left child?*/
     bool has_left() const;
 
     /** @brief get the left child.*/
-    AVLTNode<T>::Ref left() const;
+    AVLTNode<T>::Ref const& left() const;
 
     /** @brief Has it a right child? */
     bool has_right() const;
 
     /** @brief get the right child.*/
-    AVLTNode<T>::Ref right() const;
+    AVLTNode<T>::Ref const& right() const;
 
     /** @}*/
 
@@ -109,6 +128,13 @@ public:
      * @brief Set the parent.
      * @post parent()==new_parent
      */
+    void set_parent(AVLTNode<T>* new_parent);
+
+    /**
+     * @brief Set the parent.
+     * The node does not share the ownership of its parent.
+     * @post parent()==new_parent.get()
+     */
     void set_parent(AVLTNode<T>::Ref const& new_parent);
 
     /**
@@ -120,11 +146,13 @@ public:
     /**
      * @brief Set the left child.
      * @post left()==new_child
+     * @post !has_left() || left()->parent()==this
      */
-    void set_left(AVLTNode<T>::Ref const& new_child);
+    void set_left(AVLTNode<T>::Ref new_child);
 
     /**
      * @brief Remove link to the left child.
+     * The old child is left without parent.
      * @post !has_left()
      */
     void remove_left();
@@ -132,11 +160,13 @@ public:
     /**
      * @brief Set the right child.
      * @post right()==new_child
+     * @post !has_right() || right()->parent()==this
      */
-    void set_right(AVLTNode<T>::Ref const& new_child);
+    void set_right(AVLTNode<T>::Ref new_child);
 
     /**
      * @brief Remove link to the right child.
+     * The old child is left without parent.
      * @post !has_right()
      */
     void remove_right();
@@ -147,6 +177,12 @@ public:
      */
     void compute_height();
 
+    /**
+     * @brief Compute size.
+     * @post Time analysis: O(1)
+     */
+    void compute_size();
+
 protected:
 
     /**
@@ -155,12 +191,22 @@ protected:
      */
     bool check_height_invariant () const;
 
+    /**
+     * @brief Check the subtree size invariant.
+     * @return true if size() == 1 + left's size + right's size.
+     */
+    bool check_size_invariant () const;
+
+    /** The tree relinks nodes in place when it rotates them.*/
+    friend class AVLTree<T>;
+
     //
     T item_;
-    AVLTNode<T>::Ref parent_;
+    AVLTNode<T>* parent_;
     AVLTNode<T>::Ref left_;
     AVLTNode<T>::Ref right_;
     int height_;
+    int size_;
     //
 };
 
@@ -169,6 +215,12 @@ protected:
  * A AVLTree is a binary tree that meets the next two invariants:
  * is_a_binary_search_tree()
  * is_a_balanced_tree()
+ *
+ * insert() and remove() descend once recording the links of the path in a
+ * fixed-size stack and retrace it updating heights and rotating until a
+ * subtree keeps its height. Define __AVLTREE_CURSOR_UPDATE__ to use instead
+ * the cursor and make_balanced() walking up to the root. A BSTree
+ * (__ONLY_BSTREE__) always uses the cursor because its height is not bounded.
  */
 template<class T>
 class AVLTree
@@ -228,16 +280,40 @@ class AVLTree
      */
     static typename AVLTree<T>::Ref create(std::istream& in) noexcept(false);
 
-#ifdef __ONLY_BSTREE__
     /**
      * @brief create a perfectly balanced BSTree.
+     * The keys are sorted, unless they already are, and the tree is built
+     * bottom-up in O(N) linking the median of each interval.
+     * A BSTree gets the shape of inserting the medians one by one, which
+     * ignores the duplicated keys. An AVLTree is built from a copy of the
+     * keys without duplicates, so the tree is perfectly balanced.
      * @param data are the keys to be stored.
      * @return the created tree.
      * @pre data.size()>0
-     * @post for each subtree: |right()->size() - left()->size()|<=1
+     * @post data is sorted.
+     * @post for each subtree without duplicated keys:
+     *  |right()->size() - left()->size()|<=1
      */
     static typename AVLTree<T>::Ref create(std::vector<T> & data);
-#endif //#ifdef __ONLY_BSTREE__
+
+#ifndef __ONLY_BSTREE__
+    /**
+     * @brief Join two trees and a key in between.
+     * The shortest tree is linked, with k as root, where the taller one's
+     * spine has its height, and only that path is rebalanced.
+     * @param left is a tree with keys lower than k.
+     * @param k is the key.
+     * @param right is a tree with keys greater than k.
+     * @return the tree with the keys of left, k and the keys of right.
+     * @pre left->is_empty() || left's greatest key < k
+     * @pre right->is_empty() || k < right's lowest key
+     * @post left->is_empty() && right->is_empty()
+     * @post Time analysis: O(log N)
+     */
+    static typename AVLTree<T>::Ref join(typename AVLTree<T>::Ref const& left,
+                                         T const& k,
+                                         typename AVLTree<T>::Ref const& right);
+#endif //#ifndef __ONLY_BSTREE__
 
     /** @brief Destroy a AVLTree.**/
     ~AVLTree()
@@ -280,7 +356,7 @@ class AVLTree
    * @brief Computes the current's level (depth) in the tree.
    * @return the level (depth) of current in the tree.
    * @pre current_exist()
-   * @post Time analysis: O(N)
+   * @post Time analysis: O(H), walking the parent links up to the root.
    */
   int current_level() const;
 
@@ -299,6 +375,7 @@ class AVLTree
   /**
    * @brief Return the number of keys stored in the tree.
    * @return the tree's size.
+   * @post Time analysis: O(1)
    */
   int size() const;
 
@@ -323,6 +400,30 @@ class AVLTree
    */
   bool has(const T& k) const;
 
+  /**
+   * @brief Count the keys lower than a key.
+   * @return the position k has, or would have, in the in-order sequence.
+   * @post Time analysis: O(H)
+   */
+  int rank(T const& k) const;
+
+  /**
+   * @brief Get the key at a position of the in-order sequence.
+   * @param i is the position, starting at 0.
+   * @return the key with rank i.
+   * @pre 0 <= i < size()
+   * @post rank(select(i)) == i
+   * @post Time analysis: O(H)
+   */
+  T const& select(int i) const;
+
+  /**
+   * @brief Count the keys in a closed interval.
+   * @return the number of keys k with lo <= k <= hi.
+   * @post Time analysis: O(H)
+   */
+  int count_range(T const& lo, T const& hi) const;
+
   /** @}*/
 
   /** @name Modifiers*/
@@ -360,6 +461,41 @@ class AVLTree
    */
   void remove ();
 
+  /**
+   * @brief remove a key from the tree if it is there.
+   * @return true if the key was found and removed.
+   * @post not current_exists()
+   * @post !has(k)
+   */
+  bool remove (T const& k);
+
+  /**
+   * @brief Move the cursor to the lowest key.
+   * @post is_empty() || current_exists()
+   */
+  void goto_first();
+
+  /**
+   * @brief Move the cursor to the next key in order.
+   * It follows the parent links, so a whole scan is O(N).
+   * @pre current_exists()
+   */
+  void goto_next();
+
+#ifndef __ONLY_BSTREE__
+  /**
+   * @brief Split the tree by a key.
+   * @param k is the key.
+   * @param left is set to a tree with the keys lower than k.
+   * @param right is set to a tree with the keys greater than k.
+   * @return true if k was in the tree.
+   * @post is_empty()
+   * @post Time analysis: O(log N)
+   */
+  bool split(T const& k, typename AVLTree<T>::Ref& left,
+             typename AVLTree<T>::Ref& right);
+#endif //#ifndef __ONLY_BSTREE__
+
   /** @}*/
 
 protected:
@@ -389,6 +525,14 @@ protected:
    */
   static typename AVLTree<T>::Ref create (typename AVLTNode<T>::Ref root);
 
+  /**
+   * @brief Count the keys lower than (or equal to) a key.
+   * @param k is the key.
+   * @param or_equal is true to also count k.
+   * @return the number of keys counted.
+   */
+  int count_less(T const& k, bool or_equal) const;
+
   /** @brief Get the root node.*/
   typename AVLTNode<T>::Ref const& root() const;
 
@@ -410,6 +554,13 @@ protected:
    */
   void set_right(typename AVLTree<T>::Ref& subtree);
 
+  /**
+   * @brief Get the link that owns a node.
+   * @param node is a node of this tree.
+   * @return root_ or the child link of node's parent that points to it.
+   */
+  typename AVLTNode<T>::Ref& link_to(AVLTNode<T>* node);
+
   /**
    * @brief find the sucessor in order of current.
    * @pre current_exist()
@@ -418,6 +569,56 @@ protected:
    */
   void find_inorder_sucessor();
 
+  /**
+   * @brief The maximum length of an insertion or removal path.
+   * An AVLTree with N nodes has height < 1.44 log2(N+2), so 96 levels are
+   * enough for any tree that fits in memory.
+   */
+  static const size_t MAX_PATH = 96;
+
+  /**
+   * @brief Update heights and rebalance the nodes of a path bottom-up.
+   * It stops rebalancing as soon as a subtree keeps the height it had,
+   * because its ancestors' heights can not change then, and only updates
+   * the sizes of the remaining ancestors.
+   * @param path are the links to the nodes from the root downwards.
+   * @param depth is the number of links in path.
+   */
+  static void retrace(typename AVLTNode<T>::Ref** path, size_t depth);
+
+  /**
+   * @brief Rebalance a subtree whose children are balanced.
+   * @param link is the link that owns the subtree's root.
+   * @return the root of the balanced subtree.
+   * @pre |balance factor| <= 2 and the node's height is computed.
+   */
+  static AVLTNode<T>* rebalance(typename AVLTNode<T>::Ref& link);
+
+  /**
+   * @brief Join two subtrees with a node in between.
+   * @param left is the root of the subtree with the lower keys.
+   * @param middle is a node without children.
+   * @param right is the root of the subtree with the greater keys.
+   * @return the root of the joined subtree, without parent.
+   * @see join
+   */
+  static typename AVLTNode<T>::Ref join_nodes(typename AVLTNode<T>::Ref left,
+                                              typename AVLTNode<T>::Ref middle,
+                                              typename AVLTNode<T>::Ref right);
+
+  /**
+   * @brief Split a subtree by a key.
+   * @param node is the root of the subtree.
+   * @param k is the key.
+   * @param left is set to the root of the keys lower than k.
+   * @param right is set to the root of the keys greater than k.
+   * @return true if k was in the subtree.
+   * @see split
+   */
+  static bool split_nodes(typename AVLTNode<T>::Ref node, T const& k,
+                          typename AVLTNode<T>::Ref& left,
+                          typename AVLTNode<T>::Ref& right);
+
   /**
    * @brief rotate_left
    *                 n            c
@@ -425,9 +626,10 @@ protected:
    *               c   C  ->    A   n
    *              / \              / \
    *             A   B            B  C
-   * @param node is the node to be rotated.
+   * @param link is the link that owns the node to be rotated.
+   * @return the new root of the rotated subtree (c).
    */
-  void rotate_left(typename AVLTNode<T>::Ref node);
+  static AVLTNode<T>* rotate_left(typename AVLTNode<T>::Ref& link);
 
   /**
    * @brief Rotate the node to the right.
@@ -436,9 +638,10 @@ protected:
    *               A   c  ->    n   C
    *                  / \      / \
    *                 B   C    A   B
-   * @param node is the node to be rotated.
+   * @param link is the link that owns the node to be rotated.
+   * @return the new root of the rotated subtree (c).
    */
-  void rotate_right(typename AVLTNode<T>::Ref node);
+  static AVLTNode<T>* rotate_right(typename AVLTNode<T>::Ref& link);
 
   /**
    * @brief make a balanced tree.
@@ -447,9 +650,10 @@ protected:
   void make_balanced();
 
   //Chose a representation for this TAD.
+  //The cursor does not own nodes: they are owned by root_ and their parents.
   typename AVLTNode<T>::Ref root_;
-  typename AVLTNode<T>::Ref parent_;
-  typename AVLTNode<T>::Ref current_;
+  AVLTNode<T>* parent_;
+  AVLTNode<T>* current_;
   //
 
 };
@@ -1,5 +1,11 @@
 #pragma once
 
+#include <cstdlib>
+#include <iterator>
+#include <string>
+#include <stdexcept>
+#include <utility>
+
 #include "avltree.hpp"
 
 #ifdef assert
@@ -7,6 +13,13 @@
 #undef assert
 #endif
 
+#ifdef NDEBUG
+/*
+ * In Release mode the assertion must not even be evaluated: some of them
+ * check the whole tree in O(N).
+ */
+#define assert(assertion) ((void)0)
+#else
 /**
  * @brief Check an assertion.
  * In Debug mode, if the assertion is not met, a segfault is generated.
@@ -14,10 +27,9 @@
  */
 inline void assert(bool assertion)
 {
-#ifndef NDEBUG
     (void)((assertion) || (__assert ("Assert violation!", __FILE__, __LINE__),0));
-#endif
 }
+#endif
 
 /****
  * AVLTNode class implementation.
@@ -25,23 +37,40 @@ inline void assert(bool assertion)
 
 
 template <class T>
-AVLTNode<T>::AVLTNode (T const& it, AVLTNode<T>::Ref parent,
+AVLTNode<T>::AVLTNode (T const& it, AVLTNode<T>* parent,
                        AVLTNode<T>::Ref left, AVLTNode<T>::Ref right):
-    item_(it), parent_(parent), left_(left), right_(right), height_(0)
+    item_(it), parent_(parent), left_(std::move(left)),
+    right_(std::move(right)), height_(0), size_(1)
 {
     //
+    if (left_)
+        left_->parent_ = this;
+    if (right_)
+        right_->parent_ = this;
     compute_height();
+    compute_size();
     //
     assert(check_height_invariant());
+    assert(check_size_invariant());
 }
 
 template <class T>
 typename AVLTNode<T>::Ref AVLTNode<T>::create(T const& it,
-                                              AVLTNode<T>::Ref parent,
+                                              AVLTNode<T>* parent,
                                               AVLTNode<T>::Ref left,
                                               AVLTNode<T>::Ref right)
 {
-    return std::make_shared< AVLTNode<T> > (it, parent, left, right);
+    return std::make_shared< AVLTNode<T> > (it, parent, std::move(left),
+                                            std::move(right));
+}
+
+template <class T>
+AVLTNode<T>::~AVLTNode()
+{
+    if (left_ && left_->parent_ == this)
+        left_->parent_ = nullptr;
+    if (right_ && right_->parent_ == this)
+        right_->parent_ = nullptr;
 }
 
 template <class T>
@@ -57,27 +86,17 @@ int AVLTNode<T>::height() const
 }
 
 template <class T>
-int AVLTNode<T>::balance_factor() const
+int AVLTNode<T>::size() const
 {
-    int bf = 0;
-    int left_height = 0;
-    int right_height = 0;
-
-    if(has_left())
-    {
-        left_->compute_height();
-        left_height=left_->height()+1;
-    }
-
-    if(has_right())
-    {
-        right_->compute_height();
-        right_height=right_->height()+1;
-    }
-
-    bf = right_height - left_height;
+    return size_;
+}
 
-    return bf;
+template <class T>
+int AVLTNode<T>::balance_factor() const
+{
+    int left_height = has_left() ? left_->height() : -1;
+    int right_height = has_right() ? right_->height() : -1;
+    return right_height - left_height;
 }
 
 template <class T>
@@ -87,7 +106,7 @@ bool AVLTNode<T>::has_parent() const
 }
 
 template <class T>
-typename AVLTNode<T>::Ref AVLTNode<T>::parent() const
+AVLTNode<T>* AVLTNode<T>::parent() const
 {
     return parent_;
 }
@@ -99,7 +118,7 @@ bool AVLTNode<T>::has_left() const
 }
 
 template <class T>
-typename AVLTNode<T>::Ref AVLTNode<T>::left() const
+typename AVLTNode<T>::Ref const& AVLTNode<T>::left() const
 {
     return left_;
 }
@@ -111,7 +130,7 @@ bool AVLTNode<T>::has_right() const
 }
 
 template <class T>
-typename AVLTNode<T>::Ref AVLTNode<T>::right() const
+typename AVLTNode<T>::Ref const& AVLTNode<T>::right() const
 {
     return right_;
 }
@@ -119,30 +138,16 @@ typename AVLTNode<T>::Ref AVLTNode<T>::right() const
 template <class T>
 bool AVLTNode<T>::check_height_invariant () const
 {
-    bool ret_val = false;
-
-    int left_height = -1;
-    int right_height = -1;
-    int highest;
-
-    if(has_left())
-    {
-        left_height=left_->height();
-    }
-
-    if(has_right())
-    {
-        right_height=right_->height();
-    }
-
-    (left_height>right_height)?(highest=left_height+1):(highest=right_height+1);
-
-    if(highest=height_)
-    {
-        ret_val=true;
-    }
+    int left_height = has_left() ? left_->height() : -1;
+    int right_height = has_right() ? right_->height() : -1;
+    return height_ == 1 + std::max(left_height, right_height);
+}
 
-    return ret_val;
+template <class T>
+bool AVLTNode<T>::check_size_invariant () const
+{
+    return size_ == 1 + (has_left() ? left_->size() : 0)
+            + (has_right() ? right_->size() : 0);
 }
 
 template <class T>
@@ -153,88 +158,102 @@ void AVLTNode<T>::set_item(const T& new_it)
 }
 
 template <class T>
-void AVLTNode<T>::set_parent(AVLTNode<T>::Ref const& new_parent)
+void AVLTNode<T>::set_parent(AVLTNode<T>* new_parent)
 {
     parent_=new_parent;
-    compute_height();
     assert(parent()==new_parent);
 }
 
+template <class T>
+void AVLTNode<T>::set_parent(AVLTNode<T>::Ref const& new_parent)
+{
+    set_parent(new_parent.get());
+}
+
 template <class T>
 void AVLTNode<T>::remove_parent()
 {
     parent_=nullptr;
-    compute_height();
     assert(!has_parent());
 }
 
 template <class T>
-void AVLTNode<T>::set_left(AVLTNode<T>::Ref const& new_child)
+void AVLTNode<T>::set_left(AVLTNode<T>::Ref new_child)
 {
-    left_=new_child;
+    if (left_ && left_->parent_ == this)
+        left_->parent_ = nullptr;
+    left_=std::move(new_child);
+    if (left_)
+        left_->parent_ = this;
     compute_height();
+    compute_size();
     assert(check_height_invariant());
-    assert(left()==new_child);
+    assert(check_size_invariant());
+    assert(!has_left() || left()->parent()==this);
 }
 
 template <class T>
 void AVLTNode<T>::remove_left()
 {
-    left_=nullptr;
-    compute_height();
-
-    assert(check_height_invariant());
+    set_left(nullptr);
     assert(!has_left());
 }
 
 template <class T>
-void AVLTNode<T>::set_right(AVLTNode<T>::Ref const& new_child)
+void AVLTNode<T>::set_right(AVLTNode<T>::Ref new_child)
 {
-    right_=new_child;
+    if (right_ && right_->parent_ == this)
+        right_->parent_ = nullptr;
+    right_=std::move(new_child);
+    if (right_)
+        right_->parent_ = this;
     compute_height();
-
+    compute_size();
     assert(check_height_invariant());
-    assert(right()==new_child);
+    assert(check_size_invariant());
+    assert(!has_right() || right()->parent()==this);
 }
 
 template <class T>
 void AVLTNode<T>::remove_right()
 {
-    right_=nullptr;
-    compute_height();
-
-    assert(check_height_invariant());
+    set_right(nullptr);
     assert(!has_right());
 }
 
 template <class T>
 void AVLTNode<T>::compute_height()
 {
-
-
+    int left_height = has_left() ? left_->height() : -1;
+    int right_height = has_right() ? right_->height() : -1;
+    height_ = 1 + std::max(left_height, right_height);
     assert(check_height_invariant());
 }
 
+template <class T>
+void AVLTNode<T>::compute_size()
+{
+    size_ = 1 + (has_left() ? left_->size() : 0)
+            + (has_right() ? right_->size() : 0);
+    assert(check_size_invariant());
+}
+
 /***
  * AVLTree class implementation.
  ***/
 
 template <class T>
-AVLTree<T>::AVLTree ()
+AVLTree<T>::AVLTree ():
+    root_(nullptr), parent_(nullptr), current_(nullptr)
 {
-    //TODO
-
-    //
     assert(is_a_binary_search_tree());
     assert(is_a_balanced_tree());
 }
 
 template <class T>
-AVLTree<T>::AVLTree (T const& item)
+AVLTree<T>::AVLTree (T const& item):
+    root_(AVLTNode<T>::create(item)), parent_(nullptr), current_(nullptr)
 {
-    //TODO
-
-    //
     assert(is_a_binary_search_tree());
     assert(is_a_balanced_tree());
 }
@@ -260,9 +279,56 @@ typename AVLTree<T>::Ref AVLTree<T>::create(std::istream& in) noexcept(false)
     if (!in)
         throw std::runtime_error("Wrong input format");
 
-    //TODO
-
-
+    //
+    if (token == "[")
+    {
+        //The nodes whose subtrees are being read, with the number of
+        //subtrees already read, so the depth of the input does not use
+        //the call stack.
+        std::vector< std::pair<AVLTNode<T>*, int> > pending;
+        T item;
+        if (!(in >> item))
+            throw std::runtime_error("Wrong input format");
+        tree->root_ = AVLTNode<T>::create(item);
+        pending.emplace_back(tree->root_.get(), 0);
+        while (!pending.empty())
+        {
+            in >> token;
+            if (!in)
+                throw std::runtime_error("Wrong input format");
+            AVLTNode<T>* node = pending.back().first;
+            int subtrees = pending.back().second;
+            if (subtrees == 2)
+            {
+                if (token != "]")
+                    throw std::runtime_error("Wrong input format");
+                //Children are closed before their parent, so heights and
+                //sizes are computed bottom-up.
+                node->compute_height();
+                node->compute_size();
+                pending.pop_back();
+            }
+            else if (token == "[]")
+                ++pending.back().second;
+            else if (token == "[")
+            {
+                if (!(in >> item))
+                    throw std::runtime_error("Wrong input format");
+                auto child = AVLTNode<T>::create(item);
+                AVLTNode<T>* child_ptr = child.get();
+                if (subtrees == 0)
+                    node->set_left(std::move(child));
+                else
+                    node->set_right(std::move(child));
+                ++pending.back().second;
+                pending.emplace_back(child_ptr, 0);
+            }
+            else
+                throw std::runtime_error("Wrong input format");
+        }
+    }
+    else if (token != "[]")
+        throw std::runtime_error("Wrong input format");
     //
 
     if (! tree->is_a_binary_search_tree())
@@ -272,77 +338,119 @@ typename AVLTree<T>::Ref AVLTree<T>::create(std::istream& in) noexcept(false)
     return tree;
 }
 
-#ifdef __ONLY_BSTREE__
 /**
- * @brief Create a BSTree by inserting the median of an ordered sequence.
+ * @brief Build a BSTree linking the median of an ordered sequence.
+ * The tree has the shape of inserting the median of [begin, end) and
+ * then, recursively, the medians of [begin, median) and [median+1, end).
+ * A median equal to the key just before or after the interval is already
+ * in the tree so, as the insertion would, it is skipped together with the
+ * half of the interval holding only copies of it.
  * @param data is an ordered sequence of keys.
  * @param begin,
  * @param end specify a [begin, end) indexing interval of data to use.
+ * @return the root of the tree, nullptr if it is empty.
  * @pre data values are in order.
  * @pre 0 <= begin <= end <=data.size()
+ * @post Time analysis: O(end-begin)
  */
 template<class T>
-void create_inserting_median(std::vector<T> const& data,
-                             size_t begin,
-                             size_t end,
-                             typename AVLTree<T>::Ref& tree)
+typename AVLTNode<T>::Ref
+build_balanced_avltnodes(std::vector<T> const& data, size_t begin, size_t end)
 {
     assert(begin<=end);
     assert(end<=data.size());
 
-    //TODO
-    //Hint: use a recursive design by inserting the median of input
-    // (begin, end] interval
-    //and recursively, apply to each sub-interval [begin, median),
-    //[median+1, end).
+    typename AVLTNode<T>::Ref node;
+    while (node == nullptr && begin < end)
+    {
+        const size_t median = begin + (end - begin) / 2;
+        if (end < data.size() && !(data[median] < data[end]))
+            end = median;
+        else if (begin > 0 && !(data[begin - 1] < data[median]))
+            begin = median + 1;
+        else
+            node = AVLTNode<T>::create(data[median], nullptr,
+                         build_balanced_avltnodes(data, begin, median),
+                         build_balanced_avltnodes(data, median + 1, end));
+    }
+    return node;
 }
 
 template<class T>
 typename AVLTree<T>::Ref AVLTree<T>::create(std::vector<T> & data)
 {
     assert(data.size()>0);
-    auto tree = AVLTree<T>::create();
-    std::sort(data.begin(), data.end());
-    create_inserting_median(data, 0, data.size(), tree);
+    if (!std::is_sorted(data.begin(), data.end()))
+        std::sort(data.begin(), data.end());
+#ifndef __ONLY_BSTREE__
+    //The duplicated keys are removed from a copy, data only gets sorted.
+    if (std::adjacent_find(data.begin(), data.end()) != data.end())
+    {
+        std::vector<T> keys;
+        keys.reserve(data.size());
+        std::unique_copy(data.begin(), data.end(), std::back_inserter(keys));
+        auto tree = create(build_balanced_avltnodes(keys, 0, keys.size()));
+        assert(tree->is_a_binary_search_tree());
+        assert(tree->is_a_balanced_tree());
+        return tree;
+    }
+#endif
+    auto tree = create(build_balanced_avltnodes(data, 0, data.size()));
+    assert(tree->is_a_binary_search_tree());
+    assert(tree->is_a_balanced_tree());
     return tree;
 }
-#endif //#ifdef __ONLY_BSTREE__
 
 template <class T>
 bool AVLTree<T>::is_empty () const
 {
-    //TODO
-    return false;
+    return root_ == nullptr;
 }
 
 template <class T>
 T const& AVLTree<T>::item() const
 {
-    return T();
+    assert(!is_empty());
+    return root_->item();
 }
 
+/**
+ * @brief Fold the subtree rooted at node.
+ * @see AVLTree::fold
+ */
 template <class T>
-std::ostream& AVLTree<T>::fold(std::ostream& out) const
+std::ostream& fold_avltnode(std::ostream& out, AVLTNode<T> const* node)
 {
-    //TODO
-
-    //
+    if (node == nullptr)
+        out << "[]";
+    else
+    {
+        out << "[ " << node->item() << ' ';
+        fold_avltnode(out, node->left().get());
+        out << ' ';
+        fold_avltnode(out, node->right().get());
+        out << " ]";
+    }
     return out;
 }
 
+template <class T>
+std::ostream& AVLTree<T>::fold(std::ostream& out) const
+{
+    return fold_avltnode(out, root_.get());
+}
+
 template <class T>
 bool AVLTree<T>::current_exists() const
 {
-    //TODO
-    return false;
+    return current_ != nullptr;
 }
 
 template <class T>
 T const& AVLTree<T>::current() const
 {
     assert(current_exists());
-    //TODO    
-    return T();
+    return current_->item();
 }
 
 template <class T>
@@ -350,8 +458,10 @@ int AVLTree<T>::current_level() const
 {
     assert(current_exists());
     int level = 0;
-    //TODO
-
+    //
+    for (AVLTNode<T>* node = current_->parent(); node != nullptr;
+         node = node->parent())
+        ++level;
     //
     return level;
 }
@@ -360,36 +470,26 @@ template <class T>
 typename AVLTree<T>::Ref AVLTree<T>::left() const
 {
     assert(!is_empty());
-    //TODO
-    return nullptr;
+    return create(root_->left());
 }
 
 template <class T>
 typename AVLTree<T>::Ref AVLTree<T>::right() const
 {
     assert(!is_empty());
-    //TODO
-    return nullptr;
+    return create(root_->right());
 }
 
 template <class T>
 int AVLTree<T>::size() const
 {
-    int s = 0;
-    //TODO
-    if (!is_empty())
-        s = 1 + left()->size() + right()->size();
-    return s;
+    return is_empty() ? 0 : root_->size();
 }
 
 template <class T>
 int AVLTree<T>::height() const
 {
-    int h = -1;
-    //TODO
-
-    //
-    return h;
+    return is_empty() ? -1 : root_->height();
 }
 
 template <class T>
@@ -398,11 +498,7 @@ int AVLTree<T>::balance_factor() const
 #ifdef __ONLY_BSTREE__
     return 0;
 #else
-    int bf = 0;
-    //TODO
-
-    //
-    return bf;
+    return is_empty() ? 0 : root_->balance_factor();
 #endif
 }
 
@@ -416,24 +512,105 @@ bool AVLTree<T>::has(const T& k) const
       old_current = current();
 #endif
 
-  bool found = true;
-
-  //TODO
-
+  bool found = false;
 
   //
+  AVLTNode<T> const* node = root_.get();
+  while (node != nullptr && !found)
+  {
+      if (k < node->item())
+          node = node->left().get();
+      else if (node->item() < k)
+          node = node->right().get();
+      else
+          found = true;
+  }
+  //
 #ifndef NDEBUG
   assert (!old_current_exists || old_current == current());
 #endif
   return found;
 }
 
+template <class T>
+int AVLTree<T>::count_less(T const& k, bool or_equal) const
+{
+    int count = 0;
+    AVLTNode<T> const* node = root_.get();
+    while (node != nullptr)
+    {
+        if (or_equal ? k < node->item() : !(node->item() < k))
+            node = node->left().get();
+        else
+        {
+            count += 1 + (node->has_left() ? node->left()->size() : 0);
+            node = node->right().get();
+        }
+    }
+    return count;
+}
+
+template <class T>
+int AVLTree<T>::rank(T const& k) const
+{
+    return count_less(k, false);
+}
+
+template <class T>
+T const& AVLTree<T>::select(int i) const
+{
+    assert(0 <= i && i < size());
+    AVLTNode<T> const* node = root_.get();
+    int left_size = node->has_left() ? node->left()->size() : 0;
+    while (i != left_size)
+    {
+        if (i < left_size)
+            node = node->left().get();
+        else
+        {
+            i -= left_size + 1;
+            node = node->right().get();
+        }
+        left_size = node->has_left() ? node->left()->size() : 0;
+    }
+    return node->item();
+}
+
+template <class T>
+int AVLTree<T>::count_range(T const& lo, T const& hi) const
+{
+    int count = 0;
+    if (!(hi < lo))
+        count = count_less(hi, true) - count_less(lo, false);
+    return count;
+}
+
 template <class T>
 bool AVLTree<T>::is_a_binary_search_tree() const
 {
     bool is_bst = true;
-    //TODO
-
+    //
+    //In-order traversal with an explicit stack, so a degenerated BSTree does
+    //not overflow the call stack.
+    std::vector<AVLTNode<T> const*> stack;
+    AVLTNode<T> const* node = root_.get();
+    AVLTNode<T> const* prev = nullptr;
+    while (is_bst && (node != nullptr || !stack.empty()))
+    {
+        if (node != nullptr)
+        {
+            stack.push_back(node);
+            node = node->left().get();
+        }
+        else
+        {
+            node = stack.back();
+            stack.pop_back();
+            is_bst = prev == nullptr || prev->item() < node->item();
+            prev = node;
+            node = node->right().get();
+        }
+    }
     //
     return is_bst;
 }
@@ -445,9 +622,23 @@ bool AVLTree<T>::is_a_balanced_tree() const
     return true;
 #else
     bool is_balanced = true;
-    //TODO
-
-
+    //
+    //Heights are cached in the nodes, so checking each node against its
+    //children's heights checks the whole tree.
+    std::vector<AVLTNode<T> const*> stack;
+    if (!is_empty())
+        stack.push_back(root_.get());
+    while (is_balanced && !stack.empty())
+    {
+        AVLTNode<T> const* node = stack.back();
+        stack.pop_back();
+        is_balanced = node->check_height_invariant()
+                && std::abs(node->balance_factor()) <= 1;
+        if (node->has_left())
+            stack.push_back(node->left().get());
+        if (node->has_right())
+            stack.push_back(node->right().get());
+    }
     //
     return is_balanced;
 #endif
@@ -457,13 +648,13 @@ template <class T>
 void AVLTree<T>::create_root(T const& item)
 {
     assert(is_empty());
-    //TODO
-
+    //
+    root_ = AVLTNode<T>::create(item);
     //
     assert(is_a_binary_search_tree());
     assert(is_a_balanced_tree());
     assert(!is_empty());
-    assert(item()==item);
+    assert(this->item()==item);
 
 }
 
@@ -471,25 +662,50 @@ template <class T>
 bool AVLTree<T>::search(T const& k)
 {
     bool found = false;
-    //TODO
-
+    //
+    current_ = root_.get();
+    parent_ = nullptr;
+    while (current_ != nullptr && !found)
+    {
+        if (k < current_->item())
+        {
+            parent_ = current_;
+            current_ = current_->left().get();
+        }
+        else if (current_->item() < k)
+        {
+            parent_ = current_;
+            current_ = current_->right().get();
+        }
+        else
+            found = true;
+    }
     //
     assert(!found || current()==k);
     assert(found || !current_exists());
     return found;
 }
 
+#if defined(__ONLY_BSTREE__) || defined(__AVLTREE_CURSOR_UPDATE__)
+
 template <class T>
 void AVLTree<T>::insert(T const& k)
 {
     if (!search(k))
     {
-        //TODO
-
-
+        //
+        auto node = AVLTNode<T>::create(k);
+        current_ = node.get();
+        if (parent_ == nullptr)
+            root_ = std::move(node);
+        else if (k < parent_->item())
+            parent_->set_left(std::move(node));
+        else
+            parent_->set_right(std::move(node));
         //
 #ifdef __ONLY_BSTREE__
         assert(is_a_binary_search_tree());
+        make_balanced();
 #else
         assert(is_a_binary_search_tree());
         make_balanced();
@@ -502,6 +718,55 @@ void AVLTree<T>::insert(T const& k)
     assert(current()==k);
 }
 
+#else //Top-down update.
+
+template <class T>
+void AVLTree<T>::insert(T const& k)
+{
+    typename AVLTNode<T>::Ref* path[MAX_PATH];
+    size_t depth = 0;
+    typename AVLTNode<T>::Ref* link = &root_;
+    AVLTNode<T>* parent = nullptr;
+    current_ = nullptr;
+    while (*link != nullptr && current_ == nullptr)
+    {
+        AVLTNode<T>* node = link->get();
+        if (k < node->item_)
+        {
+            assert(depth < MAX_PATH);
+            path[depth++] = link;
+            parent = node;
+            link = &node->left_;
+        }
+        else if (node->item_ < k)
+        {
+            assert(depth < MAX_PATH);
+            path[depth++] = link;
+            parent = node;
+            link = &node->right_;
+        }
+        else
+            current_ = node;
+    }
+    if (current_ == nullptr)
+    {
+        *link = AVLTNode<T>::create(k, parent);
+        current_ = link->get();
+        assert(is_a_binary_search_tree());
+        retrace(path, depth);
+        assert(is_a_balanced_tree());
+    }
+    parent_ = current_->parent();
+
+    //check postconditions.
+    assert(current_exists());
+    assert(current()==k);
+}
+
+#endif //__ONLY_BSTREE__ || __AVLTREE_CURSOR_UPDATE__
+
+#if defined(__ONLY_BSTREE__) || defined(__AVLTREE_CURSOR_UPDATE__)
+
 template <class T>
 void AVLTree<T>::remove ()
 {
@@ -511,22 +776,30 @@ void AVLTree<T>::remove ()
     bool replace_with_subtree = true;
     typename AVLTNode<T>::Ref subtree;
 
-    //TODO
+    //
     // Check which of cases 0,1,2,3 we have.
-
-
+    if (!current_->has_left())
+        subtree = std::move(current_->right_);
+    else if (!current_->has_right())
+        subtree = std::move(current_->left_);
+    else
+        replace_with_subtree = false;
     //
 
     if (replace_with_subtree)
     {
-        //TODO
+        //
         //Manage cases 0,1,2
-
-
-
+        parent_ = current_->parent();
+        if (subtree)
+            subtree->parent_ = parent_;
+        //Overwriting the link that owns current releases it.
+        link_to(current_) = std::move(subtree);
+        current_ = nullptr;
         //
 #ifdef __ONLY_BSTREE__
         assert(is_a_binary_search_tree());
+        make_balanced();
         assert(! current_exists());
 #else
         assert(is_a_binary_search_tree());
@@ -537,20 +810,160 @@ void AVLTree<T>::remove ()
     }
     else
     {
-        //TODO
+        //
         //Manage case 3.
+        AVLTNode<T>* node = current_;
+        find_inorder_sucessor();
+        node->set_item(current_->item());
+        remove();
+        //
+    }
+}
 
+template <class T>
+bool AVLTree<T>::remove (T const& k)
+{
+    bool found = search(k);
+    if (found)
+        remove();
+    assert(!current_exists());
+    return found;
+}
 
-        //
+#else //Top-down update.
+
+template <class T>
+void AVLTree<T>::remove ()
+{
+    //check preconditions.
+    assert(current_exists());
+    //The key is copied because the removal may overwrite or release it.
+    const T k = current();
+#ifndef NDEBUG
+    bool found =
+#endif
+    remove(k);
+    assert(found);
+    assert(! current_exists());
+}
+
+template <class T>
+bool AVLTree<T>::remove (T const& k)
+{
+    typename AVLTNode<T>::Ref* path[MAX_PATH];
+    size_t depth = 0;
+    typename AVLTNode<T>::Ref* link = &root_;
+    bool found = false;
+    while (*link != nullptr && !found)
+    {
+        AVLTNode<T>* node = link->get();
+        if (k < node->item_ || node->item_ < k)
+        {
+            assert(depth < MAX_PATH);
+            path[depth++] = link;
+            link = k < node->item_ ? &node->left_ : &node->right_;
+        }
+        else
+            found = true;
+    }
+    if (found)
+    {
+        AVLTNode<T>* node = link->get();
+        if (node->has_left() && node->has_right())
+        {
+            //Case 3: the in-order sucessor's item replaces the removed one
+            //and the sucessor's node is the one unlinked.
+            assert(depth < MAX_PATH);
+            path[depth++] = link;
+            link = &node->right_;
+            while ((*link)->has_left())
+            {
+                assert(depth < MAX_PATH);
+                path[depth++] = link;
+                link = &(*link)->left_;
+            }
+            node->item_ = std::move((*link)->item_);
+        }
+        //Cases 0,1,2: the node is replaced by its only subtree, if any.
+        AVLTNode<T>* removed = link->get();
+        typename AVLTNode<T>::Ref subtree = std::move(
+                    removed->has_left() ? removed->left_ : removed->right_);
+        if (subtree)
+            subtree->parent_ = removed->parent_;
+        //Overwriting the link that owns the node releases it.
+        *link = std::move(subtree);
+        assert(is_a_binary_search_tree());
+        retrace(path, depth);
+        assert(is_a_balanced_tree());
     }
+    current_ = nullptr;
+    parent_ = nullptr;
+    assert(!current_exists());
+    return found;
 }
 
+#endif //__ONLY_BSTREE__ || __AVLTREE_CURSOR_UPDATE__
+
 template <class T>
-AVLTree<T>::AVLTree (typename AVLTNode<T>::Ref root_node)
+void AVLTree<T>::retrace(typename AVLTNode<T>::Ref** path, size_t depth)
 {
-    //TODO
+    bool rebalancing = true;
+    while (depth > 0)
+    {
+        typename AVLTNode<T>::Ref& link = *path[--depth];
+        if (rebalancing)
+        {
+            const int old_height = link->height();
+            link->compute_height();
+            link->compute_size();
+            rebalancing = rebalance(link)->height() != old_height;
+        }
+        else
+            link->compute_size();
+    }
 }
 
+template <class T>
+void AVLTree<T>::goto_first()
+{
+    current_ = root_.get();
+    if (current_ != nullptr)
+        while (current_->has_left())
+            current_ = current_->left().get();
+    parent_ = current_ != nullptr ? current_->parent() : nullptr;
+    assert(is_empty() || current_exists());
+}
+
+template <class T>
+void AVLTree<T>::goto_next()
+{
+    assert(current_exists());
+    if (current_->has_right())
+    {
+        current_ = current_->right().get();
+        while (current_->has_left())
+            current_ = current_->left().get();
+    }
+    else
+    {
+        //Go up until coming from a left child. The root of a subtree may
+        //have a parent out of this tree.
+        AVLTNode<T>* child = current_;
+        current_ = child != root_.get() ? child->parent() : nullptr;
+        while (current_ != nullptr && current_->right().get() == child)
+        {
+            child = current_;
+            current_ = child != root_.get() ? child->parent() : nullptr;
+        }
+    }
+    parent_ = current_ != nullptr ? current_->parent() : nullptr;
+}
+
+template <class T>
+AVLTree<T>::AVLTree (typename AVLTNode<T>::Ref root_node):
+    root_(std::move(root_node)), parent_(nullptr), current_(nullptr)
+{}
+
 template <class T>
 typename AVLTree<T>::Ref  AVLTree<T>::create (typename AVLTNode<T>::Ref root)
 {
@@ -561,18 +974,15 @@ typename AVLTree<T>::Ref  AVLTree<T>::create (typename AVLTNode<T>::Ref root)
 template <class T>
 typename AVLTNode<T>::Ref const&  AVLTree<T>::root() const
 {
-    //TODO
-    return nullptr;
+    return root_;
 }
 
 template <class T>
 void AVLTree<T>::set_left(typename AVLTree<T>::Ref& subtree)
 {
     assert(!is_empty());
-    //TODO
-    //Remenber to set parent's link of the subtree root to this.
-
-
+    //
+    root_->set_left(subtree->root_);
     //
     assert(subtree->is_empty() || left()->item()==subtree->item());
     assert(!subtree->is_empty() || left()->is_empty());
@@ -582,26 +992,37 @@ template <class T>
 void AVLTree<T>::set_right(typename AVLTree<T>::Ref& subtree)
 {
     assert(!is_empty());
-    //TODO
-    //Remenber to set parent's link of the subtree root to this.
-
-
+    //
+    root_->set_right(subtree->root_);
     //
     assert(subtree->is_empty()|| right()->item()==subtree->item());
     assert(!subtree->is_empty()|| right()->is_empty());
 }
 
+template <class T>
+typename AVLTNode<T>::Ref& AVLTree<T>::link_to(AVLTNode<T>* node)
+{
+    assert(node != nullptr);
+    if (node == root_.get())
+        return root_;
+    AVLTNode<T>* parent = node->parent();
+    assert(parent != nullptr);
+    return parent->left_.get() == node ? parent->left_ : parent->right_;
+}
+
 template <class T>
 void AVLTree<T>::find_inorder_sucessor()
 {
     assert(current_exists());
+    assert(current_->has_right());
 #ifndef NDEBUG
     T old_curr = current();
 #endif
-    //TODO
-
-
-
+    //
+    current_ = current_->right().get();
+    while (current_->has_left())
+        current_ = current_->left().get();
+    parent_ = current_->parent();
     //
     assert(current_exists());
 #ifndef NDEBUG
@@ -609,52 +1030,233 @@ void AVLTree<T>::find_inorder_sucessor()
 #endif
 }
 
+#ifndef __ONLY_BSTREE__
+
 template <class T>
-void AVLTree<T>::rotate_left(typename AVLTNode<T>::Ref node)
+typename AVLTree<T>::Ref AVLTree<T>::join(typename AVLTree<T>::Ref const& left,
+                                          T const& k,
+                                          typename AVLTree<T>::Ref const& right)
 {
-    //TODO
-    //Remenber when set a node A as child of a node B, also is needed set
-    // node B as parent of node A.
+    assert(left->is_empty() || left->select(left->size() - 1) < k);
+    assert(right->is_empty() || k < right->select(0));
+    auto tree = create(join_nodes(std::move(left->root_),
+                                  AVLTNode<T>::create(k),
+                                  std::move(right->root_)));
+    left->current_ = left->parent_ = nullptr;
+    right->current_ = right->parent_ = nullptr;
+    assert(tree->is_a_binary_search_tree());
+    assert(tree->is_a_balanced_tree());
+    assert(left->is_empty() && right->is_empty());
+    return tree;
+}
 
+template <class T>
+bool AVLTree<T>::split(T const& k, typename AVLTree<T>::Ref& left,
+                       typename AVLTree<T>::Ref& right)
+{
+    typename AVLTNode<T>::Ref left_root;
+    typename AVLTNode<T>::Ref right_root;
+    const bool found = split_nodes(std::move(root_), k, left_root, right_root);
+    current_ = parent_ = nullptr;
+    left = create(std::move(left_root));
+    right = create(std::move(right_root));
+    assert(left->is_a_binary_search_tree() && left->is_a_balanced_tree());
+    assert(right->is_a_binary_search_tree() && right->is_a_balanced_tree());
+    assert(is_empty());
+    return found;
+}
 
-    //
+#endif //#ifndef __ONLY_BSTREE__
+
+template <class T>
+typename AVLTNode<T>::Ref AVLTree<T>::join_nodes(typename AVLTNode<T>::Ref left,
+                                                 typename AVLTNode<T>::Ref middle,
+                                                 typename AVLTNode<T>::Ref right)
+{
+    assert(middle != nullptr && !middle->has_left() && !middle->has_right());
+    const int left_height = left != nullptr ? left->height() : -1;
+    const int right_height = right != nullptr ? right->height() : -1;
+    typename AVLTNode<T>::Ref root;
+    if (left_height > right_height + 1 || right_height > left_height + 1)
+    {
+        //Go down the inner spine of the taller subtree until a subtree as
+        //high as the shorter one, at most one level higher, and put the
+        //middle node in its place.
+        const bool left_taller = left_height > right_height;
+        const int shorter_height = left_taller ? right_height : left_height;
+        typename AVLTNode<T>::Ref* path[MAX_PATH];
+        size_t depth = 0;
+        typename AVLTNode<T>::Ref* link = left_taller ? &left : &right;
+        while (*link != nullptr && (*link)->height() > shorter_height + 1)
+        {
+            assert(depth < MAX_PATH);
+            path[depth++] = link;
+            link = left_taller ? &(*link)->right_ : &(*link)->left_;
+        }
+        assert(depth > 0);
+        AVLTNode<T>* parent = path[depth - 1]->get();
+        if (left_taller)
+        {
+            middle->set_left(std::move(*link));
+            middle->set_right(std::move(right));
+        }
+        else
+        {
+            middle->set_left(std::move(left));
+            middle->set_right(std::move(*link));
+        }
+        middle->parent_ = parent;
+        *link = std::move(middle);
+        retrace(path, depth);
+        root = left_taller ? std::move(left) : std::move(right);
+    }
+    else
+    {
+        middle->set_left(std::move(left));
+        middle->set_right(std::move(right));
+        root = std::move(middle);
+    }
+    root->parent_ = nullptr;
+    return root;
 }
 
 template <class T>
-void AVLTree<T>::rotate_right(typename AVLTNode<T>::Ref node)
+bool AVLTree<T>::split_nodes(typename AVLTNode<T>::Ref node, T const& k,
+                             typename AVLTNode<T>::Ref& left,
+                             typename AVLTNode<T>::Ref& right)
 {
-    //TODO
-    //Remenber when set a node A as child of a node B, also is needed set
-    // node B as parent of node A.
+    bool found = false;
+    left = nullptr;
+    right = nullptr;
+    if (node != nullptr)
+    {
+        typename AVLTNode<T>::Ref node_left = std::move(node->left_);
+        typename AVLTNode<T>::Ref node_right = std::move(node->right_);
+        if (node_left)
+            node_left->parent_ = nullptr;
+        if (node_right)
+            node_right->parent_ = nullptr;
+        //The node is reused to join the part of the subtree on its side.
+        if (k < node->item_)
+        {
+            typename AVLTNode<T>::Ref lower_right;
+            found = split_nodes(std::move(node_left), k, left, lower_right);
+            right = join_nodes(std::move(lower_right), std::move(node),
+                               std::move(node_right));
+        }
+        else if (node->item_ < k)
+        {
+            typename AVLTNode<T>::Ref lower_left;
+            found = split_nodes(std::move(node_right), k, lower_left, right);
+            left = join_nodes(std::move(node_left), std::move(node),
+                              std::move(lower_left));
+        }
+        else
+        {
+            left = std::move(node_left);
+            right = std::move(node_right);
+            found = true;
+        }
+    }
+    return found;
+}
 
-    //
+template <class T>
+AVLTNode<T>* AVLTree<T>::rebalance(typename AVLTNode<T>::Ref& link)
+{
+    AVLTNode<T>* node = link.get();
+    const int bf = node->balance_factor();
+    assert(-2 <= bf && bf <= 2);
+    if (bf < -1)
+    {
+        if (node->left()->balance_factor() > 0)
+            rotate_right(node->left_);
+        node = rotate_left(link);
+    }
+    else if (bf > 1)
+    {
+        if (node->right()->balance_factor() < 0)
+            rotate_left(node->right_);
+        node = rotate_right(link);
+    }
+    return node;
 }
 
 template <class T>
-void AVLTree<T>::make_balanced()
+AVLTNode<T>* AVLTree<T>::rotate_left(typename AVLTNode<T>::Ref& link)
 {
-#ifdef __ONLY_BSTREE__
-    return;
-#else
-    //TODO
-    //From current position, go up until root's node is achieved.
-    //In each step, check if the current subtree is balanced and balance it
-    // if not.
+    assert(link != nullptr && link->has_left());
+    //
+    //The links are moved, not copied: no reference count is touched.
+    typename AVLTNode<T>::Ref node_ref = std::move(link);
+    AVLTNode<T>* node = node_ref.get();
+    typename AVLTNode<T>::Ref child_ref = std::move(node->left_);
+    AVLTNode<T>* child = child_ref.get();
+    node->left_ = std::move(child->right_);
+    if (node->left_)
+        node->left_->parent_ = node;
+    child->parent_ = node->parent_;
+    node->parent_ = child;
+    child->right_ = std::move(node_ref);
+    link = std::move(child_ref);
+    node->compute_height();
+    node->compute_size();
+    child->compute_height();
+    child->compute_size();
+    //
+    return child;
+}
 
+template <class T>
+AVLTNode<T>* AVLTree<T>::rotate_right(typename AVLTNode<T>::Ref& link)
+{
+    assert(link != nullptr && link->has_right());
+    //
+    typename AVLTNode<T>::Ref node_ref = std::move(link);
+    AVLTNode<T>* node = node_ref.get();
+    typename AVLTNode<T>::Ref child_ref = std::move(node->right_);
+    AVLTNode<T>* child = child_ref.get();
+    node->right_ = std::move(child->left_);
+    if (node->right_)
+        node->right_->parent_ = node;
+    child->parent_ = node->parent_;
+    node->parent_ = child;
+    child->left_ = std::move(node_ref);
+    link = std::move(child_ref);
+    node->compute_height();
+    node->compute_size();
+    child->compute_height();
+    child->compute_size();
+    //
+    return child;
+}
 
+template <class T>
+void AVLTree<T>::make_balanced()
+{
+    //
+    //From parent_ go up until root's node is achieved, updating the heights
+    //and sizes. A BSTree only needs them, an AVLTree also rebalances each
+    //subtree that is not balanced.
+    AVLTNode<T>* node = parent_;
+    while (node != nullptr)
+    {
+        node->compute_height();
+        node->compute_size();
+#ifndef __ONLY_BSTREE__
+        if (std::abs(node->balance_factor()) > 1)
+            node = rebalance(link_to(node));
+#endif
+        node = node->parent();
+    }
     //
 
     if (current_exists())
     {
-        //TODO
-        // Remember that due to the rotations, the state of attributes curr and prev
-        // may be inconsistent, so we need to force that "previous of current" is the
-        // parent of "current" when current_exists().
-
-
-
+        //
+        // Due to the rotations, "previous of current" must be forced to be
+        // the parent of "current".
+        parent_ = current_->parent();
         //
     }
-
-#endif //__ONLY_BSTREE__
 }
@@ -0,0 +1,220 @@
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "avltree_imp.hpp"
+
+#if defined(__linux__)
+#include <unistd.h>
+
+/** @brief Resident set size of the process in bytes.*/
+size_t
+resident_set_size()
+{
+    size_t total_pages = 0;
+    size_t resident_pages = 0;
+    std::ifstream statm ("/proc/self/statm");
+    statm >> total_pages >> resident_pages;
+    return resident_pages * size_t(sysconf(_SC_PAGESIZE));
+}
+#else
+/** @brief The resident set size is not known in this platform.*/
+size_t
+resident_set_size()
+{
+    return 0;
+}
+#endif
+
+/**
+ * @brief Churn a tree with random insertions and removals.
+ * The tree is filled with keys drawn from [0, 2n) and then each operation
+ * removes the drawn key if it is in the tree or inserts it otherwise, so the
+ * tree keeps about n keys. A tree that leaks its removed nodes shows a
+ * growing resident set size.
+ * @param n is the number of keys kept in the tree.
+ * @param rounds is the number of rounds of churn.
+ * @param ops is the number of operations per round.
+ */
+void
+run_churn(size_t n, size_t rounds, size_t ops)
+{
+    auto tree = AVLTree<int>::create();
+    std::mt19937 gen (1);
+    std::uniform_int_distribution<int> key (0, int(2 * n) - 1);
+    size_t keys = 0;
+
+    auto start = std::chrono::steady_clock::now();
+    while (keys < n)
+    {
+        const int k = key(gen);
+        if (!tree->has(k))
+        {
+            tree->insert(k);
+            ++keys;
+        }
+    }
+    auto stop = std::chrono::steady_clock::now();
+    std::cout << "fill    \t"
+              << n / std::chrono::duration<double>(stop - start).count()
+              << " ops/s\tRSS " << resident_set_size() / (1024.0 * 1024.0)
+              << " MiB\t(keys " << keys << ", height " << tree->height()
+              << ")" << std::endl;
+
+    for (size_t round = 1; round <= rounds; ++round)
+    {
+        start = std::chrono::steady_clock::now();
+        for (size_t i = 0; i < ops; ++i)
+        {
+            const int k = key(gen);
+            if (tree->search(k))
+            {
+                tree->remove();
+                --keys;
+            }
+            else
+            {
+                tree->insert(k);
+                ++keys;
+            }
+        }
+        stop = std::chrono::steady_clock::now();
+        std::cout << "round " << round << "\t"
+                  << ops / std::chrono::duration<double>(stop - start).count()
+                  << " ops/s\tRSS " << resident_set_size() / (1024.0 * 1024.0)
+                  << " MiB\t(keys " << keys << ", height " << tree->height()
+                  << ")" << std::endl;
+    }
+}
+
+/**
+ * @brief Insert all the keys in a tree and then remove them by key.
+ * @param name is the name of the keys' order.
+ * @param keys are the keys, in the order inserted and removed.
+ */
+void
+run_insert_remove(std::string const& name, std::vector<int> const& keys)
+{
+    auto tree = AVLTree<int>::create();
+    auto start = std::chrono::steady_clock::now();
+    for (int k : keys)
+        tree->insert(k);
+    auto stop = std::chrono::steady_clock::now();
+    const int height = tree->height();
+    std::cout << name << " insert\t"
+              << keys.size() / std::chrono::duration<double>(stop - start).count()
+              << " ops/s\t(height " << height << ")" << std::endl;
+
+    //Percentile queries: the key at each percentile and the keys between
+    //two consecutive percentiles.
+    const int size = tree->size();
+    const size_t queries = std::max<size_t>(keys.size() / 10, 1);
+    std::mt19937 gen (1);
+    std::uniform_int_distribution<int> percentile (0, 99);
+    long long sum = 0;
+    start = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < queries; ++i)
+    {
+        const int p = percentile(gen);
+        const int& lo = tree->select(int((long long)(size - 1) * p / 100));
+        const int& hi = tree->select(int((long long)(size - 1) * (p + 1) / 100));
+        sum += tree->count_range(lo, hi) + tree->rank(lo);
+    }
+    stop = std::chrono::steady_clock::now();
+    std::cout << name << " queries\t"
+              << queries / std::chrono::duration<double>(stop - start).count()
+              << " ops/s\t(2 select, count_range and rank per op, sum "
+              << sum << ")" << std::endl;
+
+    size_t removed = 0;
+    start = std::chrono::steady_clock::now();
+    for (int k : keys)
+        removed += tree->remove(k);
+    stop = std::chrono::steady_clock::now();
+    std::cout << name << " remove\t"
+              << keys.size() / std::chrono::duration<double>(stop - start).count()
+              << " ops/s\t(removed " << removed << ")" << std::endl;
+}
+
+/**
+ * @brief Build a tree in bulk from sorted keys and split and join it back.
+ * @param n is the number of keys.
+ */
+void
+run_bulk(size_t n)
+{
+    std::vector<int> keys (n);
+    for (size_t i = 0; i < n; ++i)
+        keys[i] = int(i);
+    auto start = std::chrono::steady_clock::now();
+    auto tree = AVLTree<int>::create(keys);
+    auto stop = std::chrono::steady_clock::now();
+    std::cout << "bulk build\t"
+              << n / std::chrono::duration<double>(stop - start).count()
+              << " keys/s\t(height " << tree->height() << ")" << std::endl;
+
+    const size_t ops = std::max<size_t>(n / 10, 1);
+    std::mt19937 gen (1);
+    std::uniform_int_distribution<int> key (0, int(n) - 1);
+    auto left = AVLTree<int>::create();
+    auto right = AVLTree<int>::create();
+    size_t found = 0;
+    start = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < ops; ++i)
+    {
+        const int k = key(gen);
+        found += tree->split(k, left, right);
+        tree = AVLTree<int>::join(left, k, right);
+    }
+    stop = std::chrono::steady_clock::now();
+    std::cout << "split+join\t"
+              << ops / std::chrono::duration<double>(stop - start).count()
+              << " ops/s\t(found " << found << ", height " << tree->height()
+              << ")" << std::endl;
+}
+
+int
+main(int argc, const char* argv[])
+{
+    size_t n = 10000000;
+    size_t rounds = 10;
+    if (argc > 1)
+        n = std::strtoul(argv[1], nullptr, 10);
+    if (argc > 2)
+        rounds = std::strtoul(argv[2], nullptr, 10);
+    if (argc > 3 || n == 0)
+    {
+        std::cerr << "Usage: bench_avltree [n_keys [rounds]]" << std::endl;
+        std::cerr << "The churn keeps n_keys/10 keys in the tree." << std::endl;
+        return EXIT_FAILURE;
+    }
+
+#ifdef __AVLTREE_CURSOR_UPDATE__
+    std::cout << "Update: cursor and make_balanced()" << std::endl;
+#else
+    std::cout << "Update: top-down path" << std::endl;
+#endif
+    std::cout << "RSS at start " << resident_set_size() / (1024.0 * 1024.0)
+              << " MiB" << std::endl;
+
+    std::vector<int> keys (n);
+    for (size_t i = 0; i < n; ++i)
+        keys[i] = int(i);
+    std::cout << n << " keys:" << std::endl;
+    run_insert_remove("sequential", keys);
+    std::shuffle(keys.begin(), keys.end(), std::mt19937(1));
+    run_insert_remove("random    ", keys);
+    keys = std::vector<int>();
+    run_bulk(n);
+
+    const size_t churn_keys = std::max<size_t>(n / 10, 1);
+    std::cout << "Churn of an AVLTree with " << churn_keys << " keys:"
+              << std::endl;
+    run_churn(churn_keys, rounds, churn_keys);
+    return EXIT_SUCCESS;
+}
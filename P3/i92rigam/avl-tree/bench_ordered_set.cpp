@@ -0,0 +1,111 @@
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "avltree_imp.hpp"
+#include "bplustree_imp.hpp"
+
+/**
+ * @brief Print the rate of an operation.
+ * @param name is the name of the set.
+ * @param operation is the name of the operation.
+ * @param count is the number of operations done.
+ * @param seconds is the time spent.
+ * @param check is a value computed from the results, so they are used.
+ */
+void
+report(std::string const& name, std::string const& operation, size_t count,
+       double seconds, long long check)
+{
+    std::cout << name << "\t" << operation << "\t" << count / seconds
+              << " ops/s\t(" << check << ")" << std::endl;
+}
+
+/**
+ * @brief Run the same workload over an ordered set.
+ * Set must have the has/search/insert/remove/current and
+ * goto_first/goto_next interface of AVLTree.
+ * @param name is the name of the set.
+ * @param keys are the keys, in the order inserted and removed.
+ * @param lookups are the keys looked up.
+ */
+template <class Set>
+void
+run_set(std::string const& name, std::vector<int> const& keys,
+        std::vector<int> const& lookups)
+{
+    auto set = Set::create();
+    auto start = std::chrono::steady_clock::now();
+    for (int k : keys)
+        set->insert(k);
+    auto stop = std::chrono::steady_clock::now();
+    report(name, "insert", keys.size(),
+           std::chrono::duration<double>(stop - start).count(), set->size());
+
+    long long found = 0;
+    start = std::chrono::steady_clock::now();
+    for (int k : lookups)
+        found += set->has(k);
+    stop = std::chrono::steady_clock::now();
+    report(name, "has   ", lookups.size(),
+           std::chrono::duration<double>(stop - start).count(), found);
+
+    long long sum = 0;
+    start = std::chrono::steady_clock::now();
+    for (int k : lookups)
+        if (set->search(k))
+            sum += set->current();
+    stop = std::chrono::steady_clock::now();
+    report(name, "search", lookups.size(),
+           std::chrono::duration<double>(stop - start).count(), sum);
+
+    sum = 0;
+    start = std::chrono::steady_clock::now();
+    for (set->goto_first(); set->current_exists(); set->goto_next())
+        sum += set->current();
+    stop = std::chrono::steady_clock::now();
+    report(name, "scan  ", keys.size(),
+           std::chrono::duration<double>(stop - start).count(), sum);
+
+    found = 0;
+    start = std::chrono::steady_clock::now();
+    for (int k : keys)
+        found += set->remove(k);
+    stop = std::chrono::steady_clock::now();
+    report(name, "remove", keys.size(),
+           std::chrono::duration<double>(stop - start).count(), found);
+}
+
+int
+main(int argc, const char* argv[])
+{
+    size_t n = 10000000;
+    if (argc > 1)
+        n = std::strtoul(argv[1], nullptr, 10);
+    if (argc > 2 || n == 0)
+    {
+        std::cerr << "Usage: bench_ordered_set [n_keys]" << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    //The even keys in random order, half of the lookups are misses.
+    std::mt19937 gen (1);
+    std::vector<int> keys (n);
+    for (size_t i = 0; i < n; ++i)
+        keys[i] = int(2 * i);
+    std::shuffle(keys.begin(), keys.end(), gen);
+    std::vector<int> lookups (n);
+    std::uniform_int_distribution<int> key (0, int(2 * n) - 1);
+    for (auto& k : lookups)
+        k = key(gen);
+
+    std::cout << n << " random keys, " << n << " random lookups:" << std::endl;
+    run_set< AVLTree<int> >("AVLTree       ", keys, lookups);
+    run_set< BPlusTree<int, 16> >("BPlusTree<16> ", keys, lookups);
+    run_set< BPlusTree<int> >("BPlusTree<64> ", keys, lookups);
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,278 @@
+#pragma once
+
+#include <cassert>
+#include <cstddef>
+#include <memory>
+#include <iostream>
+
+/**
+ * @brief ADT BPlusTree.
+ * An ordered set of keys with the same has/search/insert/remove/current
+ * interface as AVLTree, for lookup dominated workloads.
+ * The keys are kept in wide leaves, up to B keys each, chained in order and
+ * routed by inner nodes with up to B children. A lookup touches log_B(N)
+ * nodes instead of the 1.44 log2(N) of an AVLTree, and inside a node it
+ * counts the keys lower than the searched one without branches: four keys
+ * at a time with SSE2 for int and float keys, with a generic loop for the
+ * other key types.
+ * @invariant all the leaves are at the same depth.
+ * @invariant every node but the root has at least B/2 keys (leaves) or
+ * children (inner nodes).
+ * @invariant the keys of child i of an inner node are in
+ * [keys[i-1], keys[i]).
+ */
+template <class T, int B = 64>
+class BPlusTree
+{
+    static_assert(B >= 4, "A BPlusTree node needs room for four keys.");
+
+  public:
+
+    /** @brief Define a shared reference to a BPlusTree.
+     * Manages the storage of a pointer, providing a limited garbage-collection
+     * facility, possibly sharing that management with other objects.
+     * @see http://www.cplusplus.com/reference/memory/shared_ptr/
+     */
+    typedef std::shared_ptr< BPlusTree<T, B> > Ref;
+
+  /** @name Life cicle.*/
+  /** @{*/
+
+    /**
+     * @brief Create an empty BPlusTree.
+     * @post is_empty()
+     */
+    BPlusTree ();
+
+    /**
+     * @brief Create an empty BPlusTree.
+     * @return a shared reference to the new tree.
+     */
+    static typename BPlusTree<T, B>::Ref create ();
+
+    /** @brief Destroy a BPlusTree.**/
+    ~BPlusTree();
+
+    /** @brief The nodes are owned by the tree, it can not be copied.*/
+    BPlusTree (BPlusTree<T, B> const&) = delete;
+
+    /** @brief The nodes are owned by the tree, it can not be copied.*/
+    BPlusTree<T, B>& operator=(BPlusTree<T, B> const&) = delete;
+
+  /** @}*/
+
+  /** @name Observers*/
+
+  /** @{*/
+
+  /** @brief is the tree empty?.*/
+  bool is_empty () const;
+
+  /**
+   * @brief Return the number of keys stored in the tree.
+   * @post Time analysis: O(1)
+   */
+  int size() const;
+
+  /**
+   * @brief Return the tree's height.
+   * @return the number of inner levels above the leaves, -1 if it is empty.
+   */
+  int height() const;
+
+  /**
+   * @brief Fold a BPlusTree into an output stream.
+   * The output format will be:
+   * '[ '<key>' '...' ]' for a leaf,
+   * '( '<child>' '<key>' '<child>' '...' )' for an inner node and
+   * '[]' for the empty tree.
+   * @param out is the output stream.
+   * @return the output stream.
+   */
+  std::ostream& fold(std::ostream& out) const;
+
+  /** @brief Is the cursor at a valid position?*/
+  bool current_exists() const;
+
+  /**
+   * @brief Get the current's key.
+   * @pre current_exist()
+   */
+  T const& current() const;
+
+  /**
+   * @brief Has the tree got this key
+   * @post Time analysis: O(log N)
+   */
+  bool has(const T& k) const;
+
+  /** @}*/
+
+  /** @name Modifiers*/
+
+  /** @{*/
+
+  /**
+   * @brief Search a key moving the cursor.
+   * @post retV implies current()==k
+   * @post not retv implies not current_exits()
+   */
+  bool search(T const& k);
+
+  /**
+   * @brief Insert a new key in the tree.
+   * @warning if k is already in the tree, only the cursor is moved.
+   * @post current_exists()
+   * @post current()==k
+   */
+  void insert(T const& k);
+
+  /**
+   * @brief remove current from the tree.
+   * @pre current_exists()
+   * @post not current_exists()
+   */
+  void remove ();
+
+  /**
+   * @brief remove a key from the tree if it is there.
+   * @return true if the key was found and removed.
+   * @post not current_exists()
+   * @post !has(k)
+   */
+  bool remove (T const& k);
+
+  /**
+   * @brief Move the cursor to the lowest key.
+   * @post is_empty() || current_exists()
+   */
+  void goto_first();
+
+  /**
+   * @brief Move the cursor to the next key in order.
+   * @pre current_exists()
+   * @post Time analysis: O(1)
+   */
+  void goto_next();
+
+  /** @}*/
+
+protected:
+
+  /** @brief The number of keys (leaf) or children (inner node) of a node.*/
+  struct Node
+  {
+      int n;
+  };
+
+  /** @brief A leaf with the keys in order and a link to the next leaf.*/
+  struct Leaf: public Node
+  {
+      T keys[B];
+      Leaf* next;
+  };
+
+  /** @brief An inner node routing to its children.*/
+  struct Inner: public Node
+  {
+      T keys[B - 1];
+      Node* children[B];
+  };
+
+  /** @brief A step of the path from the root to a leaf.*/
+  struct Step
+  {
+      Inner* node;
+      int child;
+  };
+
+  /**
+   * @brief The maximum number of inner levels.
+   * With at least two children per inner node, 32 levels are enough for
+   * any int size.
+   */
+  static const int MAX_DEPTH = 32;
+
+  /** @brief The minimum number of keys or children of a node but the root.*/
+  static const int MIN_N = B / 2;
+
+  /**
+   * @brief Count the keys lower than a key.
+   * @param keys are n keys in order.
+   * @param n is the number of keys.
+   * @param k is the key.
+   * @return the position of k in keys.
+   */
+  static int count_less(T const* keys, int n, T const& k);
+
+  /**
+   * @brief Count the keys lower than or equal to a key.
+   * @return the index of the child of an inner node routing k.
+   * @see count_less
+   */
+  static int count_less_equal(T const* keys, int n, T const& k);
+
+  /**
+   * @brief Go down from the root to the leaf that would hold a key.
+   * @param k is the key.
+   * @param path if not nullptr, is set with the steps from the root.
+   * @return the leaf.
+   * @pre !is_empty()
+   */
+  Leaf* find_leaf(T const& k, Step* path) const;
+
+  /**
+   * @brief Fix a child with less than MIN_N keys or children.
+   * It borrows from a sibling that can lend one or merges with a sibling.
+   * @param parent is the child's parent.
+   * @param i is the child's index.
+   * @param leaves is true if the children are leaves.
+   */
+  static void fix_underflow(Inner* parent, int i, bool leaves);
+
+  /**
+   * @brief Remove a separator key and the child at its right.
+   * @param parent is the inner node.
+   * @param s is the index of the separator.
+   */
+  static void remove_separator(Inner* parent, int s);
+
+  /**
+   * @brief Free the nodes of a subtree.
+   * @param node is the root of the subtree.
+   * @param height is the number of inner levels of the subtree.
+   */
+  static void destroy(Node* node, int height);
+
+  /**
+   * @brief Fold a subtree.
+   * @see fold
+   */
+  static std::ostream& fold(std::ostream& out, Node const* node, int height);
+
+  /**
+   * @brief Check the BPlusTree invariants.
+   * @return true if the invariants are met.
+   * @post Time Analysis: O(N)
+   */
+  bool is_a_bplus_tree() const;
+
+  /**
+   * @brief Check the invariants of a subtree.
+   * @param node is the root of the subtree.
+   * @param height is the number of inner levels of the subtree.
+   * @param lo,hi if not nullptr, are bounds of the subtree's keys: [lo, hi).
+   * @param count is increased with the number of keys of the subtree.
+   * @return true if the invariants are met.
+   */
+  static bool is_a_bplus_subtree(Node const* node, int height, T const* lo,
+                                 T const* hi, int& count);
+
+  //
+  Node* root_;
+  int height_;
+  int size_;
+  Leaf* current_leaf_;
+  int current_pos_;
+  //
+};
@@ -0,0 +1,648 @@
+#pragma once
+
+#include <utility>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+#include "bplustree.hpp"
+
+template <class T, int B>
+BPlusTree<T, B>::BPlusTree ():
+    root_(nullptr), height_(-1), size_(0), current_leaf_(nullptr),
+    current_pos_(0)
+{
+    assert(is_a_bplus_tree());
+}
+
+template <class T, int B>
+typename BPlusTree<T, B>::Ref BPlusTree<T, B>::create ()
+{
+    return std::make_shared< BPlusTree<T, B> >();
+}
+
+template <class T, int B>
+BPlusTree<T, B>::~BPlusTree()
+{
+    if (root_ != nullptr)
+        destroy(root_, height_);
+}
+
+template <class T, int B>
+bool BPlusTree<T, B>::is_empty () const
+{
+    return root_ == nullptr;
+}
+
+template <class T, int B>
+int BPlusTree<T, B>::size() const
+{
+    return size_;
+}
+
+template <class T, int B>
+int BPlusTree<T, B>::height() const
+{
+    return height_;
+}
+
+template <class T, int B>
+std::ostream& BPlusTree<T, B>::fold(std::ostream& out) const
+{
+    if (is_empty())
+        out << "[]";
+    else
+        fold(out, root_, height_);
+    return out;
+}
+
+template <class T, int B>
+std::ostream& BPlusTree<T, B>::fold(std::ostream& out, Node const* node,
+                                    int height)
+{
+    if (height == 0)
+    {
+        Leaf const* leaf = static_cast<Leaf const*>(node);
+        out << '[';
+        for (int i = 0; i < leaf->n; ++i)
+            out << ' ' << leaf->keys[i];
+        out << " ]";
+    }
+    else
+    {
+        Inner const* inner = static_cast<Inner const*>(node);
+        out << "( ";
+        fold(out, inner->children[0], height - 1);
+        for (int i = 1; i < inner->n; ++i)
+        {
+            out << ' ' << inner->keys[i - 1] << ' ';
+            fold(out, inner->children[i], height - 1);
+        }
+        out << " )";
+    }
+    return out;
+}
+
+template <class T, int B>
+bool BPlusTree<T, B>::current_exists() const
+{
+    return current_leaf_ != nullptr;
+}
+
+template <class T, int B>
+T const& BPlusTree<T, B>::current() const
+{
+    assert(current_exists());
+    return current_leaf_->keys[current_pos_];
+}
+
+/**
+ * @brief Count the keys lower than k, and lower than or equal to k.
+ * Counting instead of searching has no branch to mispredict. The int and
+ * float keys are compared four at a time with SSE2 when it is available,
+ * the generic loops are the fallback.
+ * @see BPlusTree::count_less, BPlusTree::count_less_equal
+ */
+template <class T>
+int bplus_count_less(T const* keys, int n, T const& k)
+{
+    int count = 0;
+    for (int i = 0; i < n; ++i)
+        count += keys[i] < k;
+    return count;
+}
+
+template <class T>
+int bplus_count_less_equal(T const* keys, int n, T const& k)
+{
+    int count = 0;
+    for (int i = 0; i < n; ++i)
+        count += !(k < keys[i]);
+    return count;
+}
+
+#ifdef __SSE2__
+/** @brief Add up the four 32 bit lanes of v.*/
+inline int bplus_sum_lanes(__m128i v)
+{
+    v = _mm_add_epi32(v, _mm_shuffle_epi32(v, _MM_SHUFFLE(1, 0, 3, 2)));
+    v = _mm_add_epi32(v, _mm_shuffle_epi32(v, _MM_SHUFFLE(2, 3, 0, 1)));
+    return _mm_cvtsi128_si32(v);
+}
+
+inline int bplus_count_less(int const* keys, int n, int const& k)
+{
+    //A true lane is -1, so subtracting the masks counts them.
+    const __m128i key = _mm_set1_epi32(k);
+    __m128i counts = _mm_setzero_si128();
+    int i = 0;
+    for (; i + 4 <= n; i += 4)
+    {
+        const __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(keys + i));
+        counts = _mm_sub_epi32(counts, _mm_cmplt_epi32(v, key));
+    }
+    int count = bplus_sum_lanes(counts);
+    for (; i < n; ++i)
+        count += keys[i] < k;
+    return count;
+}
+
+inline int bplus_count_less_equal(int const* keys, int n, int const& k)
+{
+    const __m128i key = _mm_set1_epi32(k);
+    __m128i greater = _mm_setzero_si128();
+    int i = 0;
+    for (; i + 4 <= n; i += 4)
+    {
+        const __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(keys + i));
+        greater = _mm_sub_epi32(greater, _mm_cmpgt_epi32(v, key));
+    }
+    int count = i - bplus_sum_lanes(greater);
+    for (; i < n; ++i)
+        count += !(k < keys[i]);
+    return count;
+}
+
+inline int bplus_count_less(float const* keys, int n, float const& k)
+{
+    const __m128 key = _mm_set1_ps(k);
+    __m128i counts = _mm_setzero_si128();
+    int i = 0;
+    for (; i + 4 <= n; i += 4)
+    {
+        const __m128 v = _mm_loadu_ps(keys + i);
+        counts = _mm_sub_epi32(counts, _mm_castps_si128(_mm_cmplt_ps(v, key)));
+    }
+    int count = bplus_sum_lanes(counts);
+    for (; i < n; ++i)
+        count += keys[i] < k;
+    return count;
+}
+
+inline int bplus_count_less_equal(float const* keys, int n, float const& k)
+{
+    //!(k < v) is "v not greater than k", which also holds for NaN.
+    const __m128 key = _mm_set1_ps(k);
+    __m128i counts = _mm_setzero_si128();
+    int i = 0;
+    for (; i + 4 <= n; i += 4)
+    {
+        const __m128 v = _mm_loadu_ps(keys + i);
+        counts = _mm_sub_epi32(counts, _mm_castps_si128(_mm_cmpngt_ps(v, key)));
+    }
+    int count = bplus_sum_lanes(counts);
+    for (; i < n; ++i)
+        count += !(k < keys[i]);
+    return count;
+}
+#endif
+
+template <class T, int B>
+int BPlusTree<T, B>::count_less(T const* keys, int n, T const& k)
+{
+    return bplus_count_less(keys, n, k);
+}
+
+template <class T, int B>
+int BPlusTree<T, B>::count_less_equal(T const* keys, int n, T const& k)
+{
+    return bplus_count_less_equal(keys, n, k);
+}
+
+template <class T, int B>
+typename BPlusTree<T, B>::Leaf* BPlusTree<T, B>::find_leaf(T const& k,
+                                                           Step* path) const
+{
+    assert(!is_empty());
+    Node* node = root_;
+    for (int level = 0; level < height_; ++level)
+    {
+        Inner* inner = static_cast<Inner*>(node);
+        const int i = count_less_equal(inner->keys, inner->n - 1, k);
+        if (path != nullptr)
+        {
+            path[level].node = inner;
+            path[level].child = i;
+        }
+        node = inner->children[i];
+    }
+    return static_cast<Leaf*>(node);
+}
+
+template <class T, int B>
+bool BPlusTree<T, B>::has(const T& k) const
+{
+    bool found = false;
+    if (!is_empty())
+    {
+        Leaf const* leaf = find_leaf(k, nullptr);
+        const int pos = count_less(leaf->keys, leaf->n, k);
+        found = pos < leaf->n && !(k < leaf->keys[pos]);
+    }
+    return found;
+}
+
+template <class T, int B>
+bool BPlusTree<T, B>::search(T const& k)
+{
+    current_leaf_ = nullptr;
+    if (!is_empty())
+    {
+        Leaf* leaf = find_leaf(k, nullptr);
+        const int pos = count_less(leaf->keys, leaf->n, k);
+        if (pos < leaf->n && !(k < leaf->keys[pos]))
+        {
+            current_leaf_ = leaf;
+            current_pos_ = pos;
+        }
+    }
+    assert(!current_exists() || current()==k);
+    return current_exists();
+}
+
+template <class T, int B>
+void BPlusTree<T, B>::insert(T const& k)
+{
+    if (is_empty())
+    {
+        Leaf* leaf = new Leaf;
+        leaf->n = 0;
+        leaf->next = nullptr;
+        root_ = leaf;
+        height_ = 0;
+    }
+    Step path[MAX_DEPTH];
+    Leaf* leaf = find_leaf(k, path);
+    const int pos = count_less(leaf->keys, leaf->n, k);
+    if (pos < leaf->n && !(k < leaf->keys[pos]))
+    {
+        current_leaf_ = leaf;
+        current_pos_ = pos;
+    }
+    else if (leaf->n < B)
+    {
+        for (int i = leaf->n; i > pos; --i)
+            leaf->keys[i] = std::move(leaf->keys[i - 1]);
+        leaf->keys[pos] = k;
+        ++leaf->n;
+        ++size_;
+        current_leaf_ = leaf;
+        current_pos_ = pos;
+    }
+    else
+    {
+        //Split the leaf: the lower half stays, the upper half goes to a
+        //new leaf whose first key separates both.
+        T keys[B + 1];
+        for (int i = 0; i < pos; ++i)
+            keys[i] = std::move(leaf->keys[i]);
+        keys[pos] = k;
+        for (int i = pos; i < B; ++i)
+            keys[i + 1] = std::move(leaf->keys[i]);
+        Leaf* right = new Leaf;
+        const int left_n = (B + 1) / 2;
+        leaf->n = left_n;
+        right->n = B + 1 - left_n;
+        for (int i = 0; i < left_n; ++i)
+            leaf->keys[i] = std::move(keys[i]);
+        for (int i = 0; i < right->n; ++i)
+            right->keys[i] = std::move(keys[left_n + i]);
+        right->next = leaf->next;
+        leaf->next = right;
+        ++size_;
+        current_leaf_ = pos < left_n ? leaf : right;
+        current_pos_ = pos < left_n ? pos : pos - left_n;
+
+        //Insert the new node in its parent, splitting it if it is full,
+        //up to a new root if needed.
+        T separator = right->keys[0];
+        Node* new_node = right;
+        int depth = height_;
+        while (new_node != nullptr && depth > 0)
+        {
+            --depth;
+            Inner* parent = path[depth].node;
+            const int i = path[depth].child;
+            if (parent->n < B)
+            {
+                for (int j = parent->n; j > i + 1; --j)
+                {
+                    parent->children[j] = parent->children[j - 1];
+                    parent->keys[j - 1] = std::move(parent->keys[j - 2]);
+                }
+                parent->children[i + 1] = new_node;
+                parent->keys[i] = std::move(separator);
+                ++parent->n;
+                new_node = nullptr;
+            }
+            else
+            {
+                T inner_keys[B];
+                Node* children[B + 1];
+                for (int j = 0; j < B; ++j)
+                    children[j + (j > i)] = parent->children[j];
+                children[i + 1] = new_node;
+                for (int j = 0; j < B - 1; ++j)
+                    inner_keys[j + (j >= i)] = std::move(parent->keys[j]);
+                inner_keys[i] = std::move(separator);
+                Inner* right_inner = new Inner;
+                const int left_children = (B + 1) / 2;
+                parent->n = left_children;
+                right_inner->n = B + 1 - left_children;
+                for (int j = 0; j < left_children; ++j)
+                    parent->children[j] = children[j];
+                for (int j = 0; j < left_children - 1; ++j)
+                    parent->keys[j] = std::move(inner_keys[j]);
+                for (int j = 0; j < right_inner->n; ++j)
+                    right_inner->children[j] = children[left_children + j];
+                for (int j = 0; j < right_inner->n - 1; ++j)
+                    right_inner->keys[j] = std::move(inner_keys[left_children + j]);
+                separator = std::move(inner_keys[left_children - 1]);
+                new_node = right_inner;
+            }
+        }
+        if (new_node != nullptr)
+        {
+            assert(height_ + 1 < MAX_DEPTH);
+            Inner* root = new Inner;
+            root->n = 2;
+            root->children[0] = root_;
+            root->children[1] = new_node;
+            root->keys[0] = std::move(separator);
+            root_ = root;
+            ++height_;
+        }
+    }
+    assert(is_a_bplus_tree());
+    assert(current_exists());
+    assert(current()==k);
+}
+
+template <class T, int B>
+void BPlusTree<T, B>::remove ()
+{
+    assert(current_exists());
+    //The key is copied because the removal overwrites it.
+    const T k = current();
+#ifndef NDEBUG
+    bool found =
+#endif
+    remove(k);
+    assert(found);
+    assert(!current_exists());
+}
+
+template <class T, int B>
+bool BPlusTree<T, B>::remove (T const& k)
+{
+    bool found = false;
+    current_leaf_ = nullptr;
+    if (!is_empty())
+    {
+        Step path[MAX_DEPTH];
+        Leaf* leaf = find_leaf(k, path);
+        const int pos = count_less(leaf->keys, leaf->n, k);
+        found = pos < leaf->n && !(k < leaf->keys[pos]);
+        if (found)
+        {
+            for (int i = pos + 1; i < leaf->n; ++i)
+                leaf->keys[i - 1] = std::move(leaf->keys[i]);
+            --leaf->n;
+            --size_;
+            //The separators are bounds, not keys, so they can keep the
+            //removed key. Only the nodes left too small are fixed.
+            Node* node = leaf;
+            int depth = height_;
+            while (depth > 0 && node->n < MIN_N)
+            {
+                --depth;
+                fix_underflow(path[depth].node, path[depth].child,
+                              depth == height_ - 1);
+                node = path[depth].node;
+            }
+            if (height_ > 0 && root_->n == 1)
+            {
+                Inner* old_root = static_cast<Inner*>(root_);
+                root_ = old_root->children[0];
+                delete old_root;
+                --height_;
+            }
+            else if (height_ == 0 && root_->n == 0)
+            {
+                delete static_cast<Leaf*>(root_);
+                root_ = nullptr;
+                height_ = -1;
+            }
+        }
+    }
+    assert(is_a_bplus_tree());
+    assert(!current_exists());
+    return found;
+}
+
+template <class T, int B>
+void BPlusTree<T, B>::remove_separator(Inner* parent, int s)
+{
+    for (int j = s + 1; j < parent->n - 1; ++j)
+        parent->keys[j - 1] = std::move(parent->keys[j]);
+    for (int j = s + 2; j < parent->n; ++j)
+        parent->children[j - 1] = parent->children[j];
+    --parent->n;
+}
+
+template <class T, int B>
+void BPlusTree<T, B>::fix_underflow(Inner* parent, int i, bool leaves)
+{
+    Node* left = i > 0 ? parent->children[i - 1] : nullptr;
+    Node* right = i + 1 < parent->n ? parent->children[i + 1] : nullptr;
+    if (leaves)
+    {
+        Leaf* leaf = static_cast<Leaf*>(parent->children[i]);
+        if (left != nullptr && left->n > MIN_N)
+        {
+            Leaf* sibling = static_cast<Leaf*>(left);
+            for (int j = leaf->n; j > 0; --j)
+                leaf->keys[j] = std::move(leaf->keys[j - 1]);
+            leaf->keys[0] = std::move(sibling->keys[--sibling->n]);
+            ++leaf->n;
+            parent->keys[i - 1] = leaf->keys[0];
+        }
+        else if (right != nullptr && right->n > MIN_N)
+        {
+            Leaf* sibling = static_cast<Leaf*>(right);
+            leaf->keys[leaf->n++] = std::move(sibling->keys[0]);
+            for (int j = 1; j < sibling->n; ++j)
+                sibling->keys[j - 1] = std::move(sibling->keys[j]);
+            --sibling->n;
+            parent->keys[i] = sibling->keys[0];
+        }
+        else
+        {
+            //Merge the right one of both leaves into the left one.
+            const int s = left != nullptr ? i - 1 : i;
+            Leaf* to = static_cast<Leaf*>(parent->children[s]);
+            Leaf* from = static_cast<Leaf*>(parent->children[s + 1]);
+            for (int j = 0; j < from->n; ++j)
+                to->keys[to->n + j] = std::move(from->keys[j]);
+            to->n += from->n;
+            to->next = from->next;
+            delete from;
+            remove_separator(parent, s);
+        }
+    }
+    else
+    {
+        Inner* inner = static_cast<Inner*>(parent->children[i]);
+        if (left != nullptr && left->n > MIN_N)
+        {
+            //Rotate the left sibling's last child through the parent.
+            Inner* sibling = static_cast<Inner*>(left);
+            for (int j = inner->n; j > 0; --j)
+                inner->children[j] = inner->children[j - 1];
+            for (int j = inner->n - 1; j > 0; --j)
+                inner->keys[j] = std::move(inner->keys[j - 1]);
+            inner->children[0] = sibling->children[sibling->n - 1];
+            inner->keys[0] = std::move(parent->keys[i - 1]);
+            parent->keys[i - 1] = std::move(sibling->keys[sibling->n - 2]);
+            --sibling->n;
+            ++inner->n;
+        }
+        else if (right != nullptr && right->n > MIN_N)
+        {
+            //Rotate the right sibling's first child through the parent.
+            Inner* sibling = static_cast<Inner*>(right);
+            inner->keys[inner->n - 1] = std::move(parent->keys[i]);
+            inner->children[inner->n] = sibling->children[0];
+            ++inner->n;
+            parent->keys[i] = std::move(sibling->keys[0]);
+            for (int j = 1; j < sibling->n; ++j)
+                sibling->children[j - 1] = sibling->children[j];
+            for (int j = 1; j < sibling->n - 1; ++j)
+                sibling->keys[j - 1] = std::move(sibling->keys[j]);
+            --sibling->n;
+        }
+        else
+        {
+            //Merge the right one of both nodes, and the separator between
+            //them, into the left one.
+            const int s = left != nullptr ? i - 1 : i;
+            Inner* to = static_cast<Inner*>(parent->children[s]);
+            Inner* from = static_cast<Inner*>(parent->children[s + 1]);
+            to->keys[to->n - 1] = std::move(parent->keys[s]);
+            for (int j = 0; j < from->n - 1; ++j)
+                to->keys[to->n + j] = std::move(from->keys[j]);
+            for (int j = 0; j < from->n; ++j)
+                to->children[to->n + j] = from->children[j];
+            to->n += from->n;
+            delete from;
+            remove_separator(parent, s);
+        }
+    }
+}
+
+template <class T, int B>
+void BPlusTree<T, B>::goto_first()
+{
+    current_leaf_ = nullptr;
+    if (!is_empty())
+    {
+        Node* node = root_;
+        for (int level = 0; level < height_; ++level)
+            node = static_cast<Inner*>(node)->children[0];
+        current_leaf_ = static_cast<Leaf*>(node);
+        current_pos_ = 0;
+    }
+    assert(is_empty() || current_exists());
+}
+
+template <class T, int B>
+void BPlusTree<T, B>::goto_next()
+{
+    assert(current_exists());
+    if (++current_pos_ == current_leaf_->n)
+    {
+        current_leaf_ = current_leaf_->next;
+        current_pos_ = 0;
+    }
+}
+
+template <class T, int B>
+void BPlusTree<T, B>::destroy(Node* node, int height)
+{
+    if (height == 0)
+        delete static_cast<Leaf*>(node);
+    else
+    {
+        Inner* inner = static_cast<Inner*>(node);
+        for (int i = 0; i < inner->n; ++i)
+            destroy(inner->children[i], height - 1);
+        delete inner;
+    }
+}
+
+template <class T, int B>
+bool BPlusTree<T, B>::is_a_bplus_tree() const
+{
+    bool is_bplus = true;
+    if (is_empty())
+        is_bplus = size_ == 0 && height_ == -1;
+    else
+    {
+        int count = 0;
+        is_bplus = height_ < MAX_DEPTH
+                && is_a_bplus_subtree(root_, height_, nullptr, nullptr, count)
+                && count == size_ && (height_ == 0 || root_->n >= 2);
+        //The leaves are chained in order.
+        Node const* node = root_;
+        for (int level = 0; level < height_; ++level)
+            node = static_cast<Inner const*>(node)->children[0];
+        Leaf const* prev = nullptr;
+        count = 0;
+        for (Leaf const* leaf = static_cast<Leaf const*>(node);
+             is_bplus && leaf != nullptr; leaf = leaf->next)
+        {
+            is_bplus = prev == nullptr
+                    || prev->keys[prev->n - 1] < leaf->keys[0];
+            count += leaf->n;
+            prev = leaf;
+        }
+        is_bplus = is_bplus && count == size_;
+    }
+    return is_bplus;
+}
+
+template <class T, int B>
+bool BPlusTree<T, B>::is_a_bplus_subtree(Node const* node, int height,
+                                         T const* lo, T const* hi, int& count)
+{
+    //The root is the only node with no bounds at both sides.
+    const bool is_root = lo == nullptr && hi == nullptr;
+    bool is_bplus = true;
+    if (height == 0)
+    {
+        Leaf const* leaf = static_cast<Leaf const*>(node);
+        is_bplus = leaf->n <= B && (is_root ? leaf->n >= 1 : leaf->n >= MIN_N);
+        for (int i = 0; is_bplus && i < leaf->n; ++i)
+            is_bplus = (i == 0 || leaf->keys[i - 1] < leaf->keys[i])
+                    && (lo == nullptr || !(leaf->keys[i] < *lo))
+                    && (hi == nullptr || leaf->keys[i] < *hi);
+        count += leaf->n;
+    }
+    else
+    {
+        Inner const* inner = static_cast<Inner const*>(node);
+        is_bplus = inner->n <= B && (is_root ? inner->n >= 2
+                                             : inner->n >= MIN_N);
+        for (int i = 0; is_bplus && i < inner->n; ++i)
+        {
+            T const* child_lo = i == 0 ? lo : &inner->keys[i - 1];
+            T const* child_hi = i == inner->n - 1 ? hi : &inner->keys[i];
+            is_bplus = (child_lo == nullptr || child_hi == nullptr
+                        || *child_lo < *child_hi)
+                    && is_a_bplus_subtree(inner->children[i], height - 1,
+                                          child_lo, child_hi, count);
+        }
+    }
+    return is_bplus;
+}
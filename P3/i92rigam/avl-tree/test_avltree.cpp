@@ -28,6 +28,8 @@ main(int argc, const char* argv[])
 
 
         auto tree = AVLTree<int>::create();
+        auto left_tree = AVLTree<int>::create();
+        auto right_tree = AVLTree<int>::create();
         AVLTNode<int>::Ref node[10];
         std::string command;
         std::cout << std::unitbuf;
@@ -142,7 +144,6 @@ main(int argc, const char* argv[])
                     std::cout << "Input error: " << e.what() << std::endl;
                 }
             }
-#ifdef __ONLY_BSTREE__
             else if (command == "CREATE_PERFECTLY_BALANCED")
             {
                 std::string buffer;
@@ -156,7 +157,41 @@ main(int argc, const char* argv[])
                 tree = AVLTree<int>::create(data);
                 std::cout << " ok. " << std::endl;
             }
-#endif//#ifdef __ONLY_BSTREE__
+#ifndef __ONLY_BSTREE__
+            else if (command == "SPLIT")
+            {
+                int key;
+                input_file >> key;
+                if (!input_file)
+                {
+                    std::cerr << "Error: wrong format of test file."
+                              << std::endl;
+                    return EXIT_FAILURE;
+                }
+                std::cout << "Splitting by key value " << key << " ... "
+                          << (tree->split(key, left_tree, right_tree)
+                              ? " found." : "not found.") << std::endl;
+                std::cout << "Left: ";
+                left_tree->fold(std::cout);
+                std::cout << std::endl << "Right: ";
+                right_tree->fold(std::cout);
+                std::cout << std::endl;
+            }
+            else if (command == "JOIN")
+            {
+                int key;
+                input_file >> key;
+                if (!input_file)
+                {
+                    std::cerr << "Error: wrong format of test file."
+                              << std::endl;
+                    return EXIT_FAILURE;
+                }
+                std::cout << "Joining left and right by key value " << key
+                          << std::endl;
+                tree = AVLTree<int>::join(left_tree, key, right_tree);
+            }
+#endif//#ifndef __ONLY_BSTREE__
             else if (command == "HAS")
             {
                 int key;
@@ -200,6 +235,50 @@ main(int argc, const char* argv[])
                 std::cout << "Current's level is " << tree->current_level()
                           << std::endl;
             }
+            else if (command == "SIZE")
+            {
+                std::cout << "Size = " << tree->size() << std::endl;
+            }
+            else if (command == "RANK")
+            {
+                int key;
+                input_file >> key;
+                if (!input_file)
+                {
+                    std::cerr << "Error: wrong format of test file."
+                              << std::endl;
+                    return EXIT_FAILURE;
+                }
+                std::cout << "Rank of key value " << key << " = "
+                          << tree->rank(key) << std::endl;
+            }
+            else if (command == "SELECT")
+            {
+                int i;
+                input_file >> i;
+                if (!input_file)
+                {
+                    std::cerr << "Error: wrong format of test file."
+                              << std::endl;
+                    return EXIT_FAILURE;
+                }
+                std::cout << "Key at position " << i << " = "
+                          << tree->select(i) << std::endl;
+            }
+            else if (command == "COUNT_RANGE")
+            {
+                int lo;
+                int hi;
+                input_file >> lo >> hi;
+                if (!input_file)
+                {
+                    std::cerr << "Error: wrong format of test file."
+                              << std::endl;
+                    return EXIT_FAILURE;
+                }
+                std::cout << "Keys in [" << lo << ", " << hi << "] = "
+                          << tree->count_range(lo, hi) << std::endl;
+            }
             else if (command == "INSERT")
             {
                 std::string buffer;
@@ -222,6 +301,14 @@ main(int argc, const char* argv[])
                 tree->remove();
                 std::cout << " ok." << std::endl;
             }
+            else if (command == "SCAN")
+            {
+                std::cout << "Keys in order:";
+                for (tree->goto_first(); tree->current_exists();
+                     tree->goto_next())
+                    std::cout << ' ' << tree->current();
+                std::cout << std::endl;
+            }
             else if (command == "FOLD")
             {
                tree->fold(std::cout);
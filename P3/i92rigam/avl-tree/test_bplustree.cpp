@@ -0,0 +1,150 @@
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <exception>
+#include <vector>
+#include "bplustree_imp.hpp"
+
+int
+main(int argc, const char* argv[])
+{
+    int exit_code = EXIT_SUCCESS;
+    try
+    {
+        if (argc != 2)
+        {
+            std::cerr << "Usage: " << argv[0] << " filename" << std::endl;
+            return EXIT_FAILURE;
+        }
+        std::ifstream input_file (argv[1]);
+        if (!input_file)
+        {
+            std::cerr << "Error: could not open input filename '"
+                      << argv[1] << "'." << std::endl;
+            std::cerr << "Usage: " << argv[0] << " filename" << std::endl;
+            return EXIT_FAILURE;
+        }
+
+        //Small nodes so a few keys split and merge them.
+        auto tree = BPlusTree<int, 4>::create();
+        std::string command;
+        std::cout << std::unitbuf;
+        while(input_file >> command)
+        {
+            if (command == "IS_EMPTY")
+            {
+                std::cout << "Is it empty? "
+                          << (tree->is_empty() ? "Y." : "N.")
+                          << std::endl;
+            }
+            else if (command == "SIZE")
+            {
+                std::cout << "Size = " << tree->size() << std::endl;
+            }
+            else if (command == "HEIGHT")
+            {
+                std::cout << "Height = " << tree->height() << std::endl;
+            }
+            else if (command == "HAS")
+            {
+                int key;
+                input_file >> key;
+                if (!input_file)
+                {
+                    std::cerr << "Error: wrong format of test file."
+                              << std::endl;
+                    return EXIT_FAILURE;
+                }
+                std::cout << "Has key value " << key << " ?: "
+                          << (tree->has(key) ? "Y.": "N.") << std::endl;
+            }
+            else if (command == "SEARCH")
+            {
+                int key;
+                input_file >> key;
+                if (!input_file)
+                {
+                    std::cerr << "Error: wrong format of test file."
+                              << std::endl;
+                    return EXIT_FAILURE;
+                }
+                std::cout << "Search for key value " << key << " ... "
+                          << (tree->search(key) ? " found.": "not found.")
+                          << std::endl;
+            }
+            else if (command == "CURRENT_EXISTS")
+            {
+                std::cout << "Has a current item? "
+                          << (tree->current_exists() ? "Y." : "N.")
+                          << std::endl;
+            }
+            else if (command == "CURRENT")
+            {
+                std::cout << "Current item: "
+                          << tree->current() << std::endl;
+            }
+            else if (command == "INSERT")
+            {
+                std::string buffer;
+                std::getline(input_file, buffer);
+                std::istringstream numbers (buffer);
+                int key;
+                numbers >> key;
+                std::cout << "Inserting ";
+                while (numbers)
+                {
+                    std::cout << key << ' ';
+                    tree->insert(key);
+                    numbers >> key;
+                }
+                std::cout << std::endl;
+            }
+            else if (command == "REMOVE")
+            {
+                std::cout << "Removing key " << tree->current();
+                tree->remove();
+                std::cout << " ok." << std::endl;
+            }
+            else if (command == "REMOVE_KEYS")
+            {
+                std::string buffer;
+                std::getline(input_file, buffer);
+                std::istringstream numbers (buffer);
+                int key;
+                numbers >> key;
+                std::cout << "Removing ";
+                while (numbers)
+                {
+                    std::cout << key << (tree->remove(key) ? " " : "(no) ");
+                    numbers >> key;
+                }
+                std::cout << std::endl;
+            }
+            else if (command == "SCAN")
+            {
+                std::cout << "Keys in order:";
+                for (tree->goto_first(); tree->current_exists();
+                     tree->goto_next())
+                    std::cout << ' ' << tree->current();
+                std::cout << std::endl;
+            }
+            else if (command == "FOLD")
+            {
+               tree->fold(std::cout);
+               std::cout << std::endl;
+            }
+            else
+            {
+                std::cerr << "Error: input command unknown '" << command
+                          << "'." << std::endl;
+                return EXIT_FAILURE;
+            }
+        }
+    }
+    catch(...)
+    {
+        std::cerr << "Catched unknown exception!." << std::endl;
+        exit_code = EXIT_FAILURE;
+    }
+    return exit_code;
+}